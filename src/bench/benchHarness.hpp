@@ -0,0 +1,110 @@
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+/**
+ * @brief Measures the part of a benchmark iteration that matters.
+ *
+ * A benchmark body that has setup work to leave out, like copying a raster into a fresh dataset, brackets
+ * the measured work with start() and stop(). Bodies that never call them are timed as a whole.
+ */
+class BenchTimer
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  void start()
+  {
+    started = Clock::now();
+    running = true;
+    used = true;
+  }
+  void stop()
+  {
+    if (running)
+      elapsed += Clock::now() - started;
+    running = false;
+  }
+
+private:
+  friend class BenchRunner;
+  Clock::time_point started;
+  Clock::duration elapsed{0};
+  bool running = false;
+  bool used = false;
+};
+
+/**
+ * @brief Minimal benchmark runner, runs every benchmark until it has been measured for a minimum time.
+ */
+class BenchRunner
+{
+public:
+  struct Result
+  {
+    std::string name;
+    uint64_t cells;
+    uint64_t iterations;
+    double secondsPerIteration;
+  };
+
+  explicit BenchRunner(double minSeconds = 1, std::string filter = "") : minSeconds(minSeconds), filter(std::move(filter)) {}
+
+  /**
+   * @brief Runs body until it has been measured for minSeconds, but at least once, and prints the time per iteration.
+   *
+   * @param name Unique name of the benchmark, skipped unless it contains the filter.
+   * @param cells Number of raster cells one iteration processes, for the throughput column.
+   * @param body The work of one iteration.
+   */
+  void run(const std::string &name, uint64_t cells, const std::function<void(BenchTimer &)> &body)
+  {
+    if (!selected(name))
+      return;
+    double measured = 0;
+    uint64_t iterations = 0;
+    while (iterations == 0 || (measured < minSeconds && iterations < MAX_ITERATIONS))
+    {
+      BenchTimer timer;
+      BenchTimer::Clock::time_point begin = BenchTimer::Clock::now();
+      body(timer);
+      timer.stop();
+      BenchTimer::Clock::duration duration = timer.used ? timer.elapsed : BenchTimer::Clock::now() - begin;
+      measured += std::chrono::duration<double>(duration).count();
+      ++iterations;
+    }
+    Result result{name, cells, iterations, measured / double(iterations)};
+    results.push_back(result);
+    std::cout << std::left << std::setw(44) << name << std::right << std::setw(8) << iterations << std::setw(14) << std::fixed
+              << std::setprecision(3) << result.secondsPerIteration * 1000 << " ms" << std::setw(12) << std::setprecision(2)
+              << double(cells) / result.secondsPerIteration / 1e6 << " Mcells/s" << std::defaultfloat << std::endl;
+  }
+
+  /**
+   * @brief True if a benchmark of this name would run, lets callers skip expensive setup.
+   */
+  bool selected(const std::string &name) const
+  {
+    return filter.empty() || name.find(filter) != std::string::npos;
+  }
+
+  const std::vector<Result> &allResults() const
+  {
+    return results;
+  }
+
+private:
+  static constexpr uint64_t MAX_ITERATIONS = 1000;
+  double minSeconds;
+  std::string filter;
+  std::vector<Result> results;
+};
+
+#endif // BENCH_HARNESS_H
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <gdal_priv.h>
+
+#include "benchHarness.hpp"
+#include "syntheticDem.hpp"
+#include "../computation/gdal_computation.hpp"
+#include "../prominence/prominence.hpp"
+#include "../prominence/runStats.hpp"
+
+using namespace std;
+
+namespace
+{
+  constexpr double PYRAMID_THRESHOLD = 30; // Prominence threshold of the pyramid pre-pass benchmarks
+
+  vector<string> splitList(const string &list)
+  {
+    vector<string> items;
+    stringstream stream(list);
+    string item;
+    while (getline(stream, item, ','))
+    {
+      if (!item.empty())
+        items.push_back(item);
+    }
+    return items;
+  }
+
+  /**
+   * Benchmarks the stages of the water level engine on their own, on a raster loaded once.
+   */
+  void benchStages(BenchRunner &runner, const string &prefix, GDALDataset *dataset)
+  {
+    auto matrixData = loadRaster(dataset);
+    const ElevationGrid &grid = matrixData.second;
+    uint64_t cells = uint64_t(grid.width) * grid.height;
+
+    runner.run(prefix + "loadRaster", cells, [&](BenchTimer &)
+               { loadRaster(dataset); });
+    runner.run(prefix + "findPeakIslands", cells, [&](BenchTimer &)
+               { findPeakIslands(grid); });
+    runner.run(prefix + "processRange", cells, [&](BenchTimer &)
+               {
+                 vector<Coords> candidates;
+                 processRange(grid, candidates, 0, grid.height, 1); });
+    runner.run(prefix + "neighbors", cells, [&](BenchTimer &)
+               {
+                 size_t neighborCount = 0;
+                 for (int y = 0; y < grid.height; ++y)
+                   for (int x = 0; x < grid.width; ++x)
+                     neighborCount += neighbors(Coords(x, y), grid.height, grid.width).size();
+                 if (neighborCount == 0)
+                   cerr << "No neighbours found\n"; });
+    runner.run(prefix + "waterLevels", cells, [&](BenchTimer &)
+               { waterLevels(grid, matrixData.first, 1); });
+    runner.run(prefix + "waterLevels/step0", cells, [&](BenchTimer &)
+               { waterLevels(grid, matrixData.first, 0); });
+  }
+
+  bool sameCoords(const Coords &a, const Coords &b)
+  {
+    return a.x == b.x && a.y == b.y;
+  }
+
+  /**
+   * True if both runs found the same peaks with the same prominence, key col elevation and parent. Where
+   * several points at the same elevation could be the key col, runs may pick different ones.
+   */
+  bool samePeaks(vector<PeakResult> a, vector<PeakResult> b)
+  {
+    auto byPosition = [](const PeakResult &p, const PeakResult &q)
+    {
+      return p.peakCoords.y < q.peakCoords.y || (p.peakCoords.y == q.peakCoords.y && p.peakCoords.x < q.peakCoords.x);
+    };
+    sort(a.begin(), a.end(), byPosition);
+    sort(b.begin(), b.end(), byPosition);
+    return equal(a.begin(), a.end(), b.begin(), b.end(), [](const PeakResult &p, const PeakResult &q)
+                 { return sameCoords(p.peakCoords, q.peakCoords) && p.prominence == q.prominence && (p.colElevation == q.colElevation || (isnan(p.colElevation) && isnan(q.colElevation))) &&
+                          sameCoords(p.parentCoords, q.parentCoords); });
+  }
+
+  /**
+   * Benchmarks whole runs of every engine. Engines release their dataset, so every iteration gets a fresh
+   * copy, which is not part of the measured time. Results are discarded, except that the pyramid pre-pass
+   * is checked against the same run without it.
+   *
+   * @return False if the pyramid pre-pass changed the result.
+   */
+  bool benchEngines(BenchRunner &runner, const string &prefix, const SyntheticDem &dem)
+  {
+    uint64_t cells = uint64_t(dem.width) * dem.height;
+    auto runEngine = [&](const string &name, const function<void(unique_ptr<GDALDataset> &, RunStats &)> &engine)
+    {
+      runner.run(prefix + name, cells, [&](BenchTimer &timer)
+                 {
+                   unique_ptr<GDALDataset> dataset = dem.toDataset();
+                   RunStats stats(name);
+                   timer.start();
+                   engine(dataset, stats);
+                   timer.stop(); });
+    };
+    runEngine("waterlevel", [](unique_ptr<GDALDataset> &dataset, RunStats &stats)
+              { calculateProminence(dataset, "", 0, false, stats, 1); });
+    runEngine("waterlevel/step0", [](unique_ptr<GDALDataset> &dataset, RunStats &stats)
+              { calculateProminence(dataset, "", 0, false, stats, 0); });
+    runEngine("waterlevel/serial", [](unique_ptr<GDALDataset> &dataset, RunStats &stats)
+              { calculateProminence(dataset, "", 0, false, stats, 1, false); });
+    runEngine("unionfind", [](unique_ptr<GDALDataset> &dataset, RunStats &stats)
+              { calculateProminenceUnionFind(dataset, "", 0, false, stats); });
+    runEngine("tiled", [](unique_ptr<GDALDataset> &dataset, RunStats &stats)
+              { calculateProminenceTiled(dataset, "", 0, false, stats, 1024, size_t(4096) * 1024 * 1024); });
+
+    // The library entry point works on the generated raster directly, no dataset involved
+    RasterView view;
+    view.elevations = dem.elevations.data();
+    view.width = dem.width;
+    view.height = dem.height;
+    view.hasNoData = dem.hasNoData;
+    view.noDataValue = dem.noDataValue;
+    runner.run(prefix + "view/waterlevel", cells, [&](BenchTimer &)
+               {
+                 vector<PeakResult> peaks;
+                 computeProminence(view, ProminenceOptions(), peaks); });
+
+    // The pyramid pre-pass only drops peaks when there is a threshold, so it is compared on the run it speeds up
+    ProminenceOptions exact;
+    exact.waterLevelStep = 0;
+    exact.prominenceThreshold = PYRAMID_THRESHOLD;
+    ProminenceOptions pyramid = exact;
+    pyramid.pyramidPrePass = true;
+    string suffix = "/t" + to_string(int(PYRAMID_THRESHOLD));
+    bool matches = true;
+    if (runner.selected(prefix + "view/pyramid" + suffix))
+    {
+      vector<PeakResult> exactPeaks, pyramidPeaks;
+      computeProminence(view, exact, exactPeaks);
+      computeProminence(view, pyramid, pyramidPeaks);
+      matches = samePeaks(std::move(exactPeaks), std::move(pyramidPeaks));
+      if (!matches)
+        cerr << prefix << "view/pyramid" << suffix << " differs from the run without the pre-pass\n";
+    }
+    runner.run(prefix + "view/step0" + suffix, cells, [&](BenchTimer &)
+               {
+                 vector<PeakResult> peaks;
+                 computeProminence(view, exact, peaks); });
+    runner.run(prefix + "view/pyramid" + suffix, cells, [&](BenchTimer &)
+               {
+                 vector<PeakResult> peaks;
+                 computeProminence(view, pyramid, peaks); });
+    return matches;
+  }
+}
+
+/**
+ * @brief Benchmarks the pipeline stages and the engines on generated terrain.
+ *
+ * Every combination of terrain kind and size is generated in memory with a fixed seed, so runs on
+ * different commits measure exactly the same input. Results are printed as a table and can be written
+ * to a CSV file for comparison.
+ */
+int main(int argc, char *argv[])
+{
+  GDALAllRegister();
+
+  vector<string> kinds = {"fractal", "pyramids", "plateaus", "ocean"};
+  vector<string> sizes = {"1024", "2048"};
+  double minSeconds = 1;
+  string filter;
+  string csvFilePath;
+
+  for (int i = 1; i < argc; i++)
+  {
+    string arg = argv[i];
+    if (arg == "-kinds" && i + 1 < argc)
+      kinds = splitList(argv[++i]);
+    else if (arg == "-sizes" && i + 1 < argc)
+      sizes = splitList(argv[++i]);
+    else if (arg == "-min-time" && i + 1 < argc)
+      minSeconds = stod(argv[++i]);
+    else if (arg == "-filter" && i + 1 < argc)
+      filter = argv[++i];
+    else if (arg == "-csv" && i + 1 < argc)
+      csvFilePath = argv[++i];
+    else
+    {
+      cerr << "Usage: " << argv[0] << " [-kinds fractal,pyramids,plateaus,ocean] [-sizes 1024,2048,...] [-min-time seconds] [-filter text] [-csv results.csv]" << endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  BenchRunner runner(minSeconds, filter);
+  bool allMatch = true;
+  for (const string &kindName : kinds)
+  {
+    TerrainKind kind = parseTerrainKind(kindName);
+    for (const string &sizeName : sizes)
+    {
+      int size = stoi(sizeName);
+      string prefix = kindName + "/" + to_string(size) + "/";
+      SyntheticDem dem = generateDem(kind, size, size);
+      unique_ptr<GDALDataset> dataset = dem.toDataset();
+      benchStages(runner, prefix, dataset.get());
+      dataset.reset();
+      allMatch = benchEngines(runner, prefix, dem) && allMatch;
+    }
+  }
+
+  if (!csvFilePath.empty())
+  {
+    ofstream csv(csvFilePath);
+    csv << "name,cells,iterations,seconds_per_iteration\n";
+    for (const auto &result : runner.allResults())
+      csv << result.name << ',' << result.cells << ',' << result.iterations << ',' << result.secondsPerIteration << '\n';
+  }
+  return allMatch ? EXIT_SUCCESS : EXIT_FAILURE;
+}
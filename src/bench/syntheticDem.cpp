@@ -0,0 +1,184 @@
+#include "syntheticDem.hpp"
+#include "../prominence/taskPool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <ogr_spatialref.h>
+
+using namespace std;
+
+namespace
+{
+  uint32_t hash(int32_t x, int32_t y, uint32_t seed)
+  {
+    uint32_t h = seed * 0x9E3779B9u ^ uint32_t(x) * 0x85EBCA6Bu ^ uint32_t(y) * 0xC2B2AE35u;
+    h ^= h >> 16;
+    h *= 0x7FEB352Du;
+    h ^= h >> 15;
+    h *= 0x846CA68Bu;
+    h ^= h >> 16;
+    return h;
+  }
+
+  // Uniform value in [0, 1) attached to a lattice point
+  float latticeValue(int32_t x, int32_t y, uint32_t seed)
+  {
+    return float(hash(x, y, seed) >> 8) / float(1 << 24);
+  }
+
+  // Smoothly interpolated lattice noise with the given wavelength in pixels
+  float valueNoise(float x, float y, float wavelength, uint32_t seed)
+  {
+    float fx = x / wavelength;
+    float fy = y / wavelength;
+    int32_t x0 = int32_t(floor(fx));
+    int32_t y0 = int32_t(floor(fy));
+    float tx = fx - float(x0);
+    float ty = fy - float(y0);
+    tx = tx * tx * (3 - 2 * tx);
+    ty = ty * ty * (3 - 2 * ty);
+    float top = latticeValue(x0, y0, seed) + (latticeValue(x0 + 1, y0, seed) - latticeValue(x0, y0, seed)) * tx;
+    float bottom = latticeValue(x0, y0 + 1, seed) + (latticeValue(x0 + 1, y0 + 1, seed) - latticeValue(x0, y0 + 1, seed)) * tx;
+    return top + (bottom - top) * ty;
+  }
+
+  /**
+   * Fractal Brownian motion: octaves of value noise, each half the wavelength and amplitude of the one
+   * before. Computed per pixel, so unlike diamond-square it needs no power of two sized working grid and
+   * the largest benchmark sizes fit in memory.
+   */
+  float fractal(int x, int y, uint32_t seed)
+  {
+    float elevation = 0;
+    float amplitude = 1000;
+    float wavelength = 512;
+    for (int octave = 0; octave < 9; ++octave)
+    {
+      elevation += amplitude * valueNoise(float(x), float(y), wavelength, seed + octave);
+      amplitude *= 0.5f;
+      wavelength *= 0.5f;
+    }
+    return elevation;
+  }
+
+  /**
+   * Every 64 by 64 pixel cell holds one pyramid with a random apex and height. A point takes the highest
+   * of the pyramids in its own and the surrounding cells.
+   */
+  float pyramids(int x, int y, uint32_t seed)
+  {
+    constexpr int cellSize = 64;
+    constexpr float slope = 4;
+    int cellX = x / cellSize;
+    int cellY = y / cellSize;
+    float elevation = 0;
+    for (int dy = -1; dy <= 1; ++dy)
+    {
+      for (int dx = -1; dx <= 1; ++dx)
+      {
+        int cx = cellX + dx;
+        int cy = cellY + dy;
+        uint32_t h = hash(cx, cy, seed);
+        int apexX = cx * cellSize + int(h % cellSize);
+        int apexY = cy * cellSize + int((h >> 8) % cellSize);
+        float apexHeight = 50 + float(h >> 16) / 65536.0f * 450;
+        int distance = max(abs(x - apexX), abs(y - apexY));
+        elevation = max(elevation, apexHeight - slope * float(distance));
+      }
+    }
+    return elevation;
+  }
+}
+
+const char *terrainName(TerrainKind kind)
+{
+  switch (kind)
+  {
+  case TerrainKind::Fractal:
+    return "fractal";
+  case TerrainKind::Pyramids:
+    return "pyramids";
+  case TerrainKind::Plateaus:
+    return "plateaus";
+  case TerrainKind::Ocean:
+    return "ocean";
+  }
+  return "";
+}
+
+TerrainKind parseTerrainKind(const string &name)
+{
+  for (TerrainKind kind : {TerrainKind::Fractal, TerrainKind::Pyramids, TerrainKind::Plateaus, TerrainKind::Ocean})
+  {
+    if (name == terrainName(kind))
+      return kind;
+  }
+  throw invalid_argument("Unknown terrain kind: " + name);
+}
+
+SyntheticDem generateDem(TerrainKind kind, int width, int height, uint32_t seed)
+{
+  SyntheticDem dem;
+  dem.width = width;
+  dem.height = height;
+  dem.hasNoData = kind == TerrainKind::Ocean;
+  dem.elevations.resize(size_t(width) * height);
+
+  TaskPool::shared().parallelFor(size_t(height), 16, [&](size_t startRow, size_t endRow, unsigned)
+                                 {
+                                   for (size_t y = startRow; y < endRow; ++y)
+                                   {
+                                     float *row = dem.elevations.data() + y * width;
+                                     for (int x = 0; x < width; ++x)
+                                     {
+                                       float elevation;
+                                       switch (kind)
+                                       {
+                                       case TerrainKind::Pyramids:
+                                         elevation = pyramids(x, int(y), seed);
+                                         break;
+                                       case TerrainKind::Plateaus:
+                                         // 40 m terraces leave wide flat summits and shelves
+                                         elevation = floor(fractal(x, int(y), seed) / 40) * 40;
+                                         break;
+                                       case TerrainKind::Ocean:
+                                         // Roughly the lower half of the terrain is sea
+                                         elevation = fractal(x, int(y), seed) - 950;
+                                         if (elevation < 0)
+                                           elevation = dem.noDataValue;
+                                         break;
+                                       default:
+                                         elevation = fractal(x, int(y), seed);
+                                       }
+                                       row[x] = elevation;
+                                     }
+                                   } });
+  return dem;
+}
+
+unique_ptr<GDALDataset> SyntheticDem::toDataset() const
+{
+  GDALDriver *driver = GetGDALDriverManager()->GetDriverByName("MEM");
+  if (!driver)
+    throw runtime_error("The GDAL MEM driver is not available.");
+  unique_ptr<GDALDataset> dataset(driver->Create("", width, height, 1, GDT_Float32, nullptr));
+  if (!dataset)
+    throw runtime_error("Unable to create an in-memory dataset.");
+
+  // About 30 m pixels in the north of Iceland, any WGS 84 extent works
+  double geoTransform[6] = {-20, 0.0003, 0, 66, 0, -0.0003};
+  dataset->SetGeoTransform(geoTransform);
+  OGRSpatialReference wgs84;
+  wgs84.importFromEPSG(4326);
+  char *wkt = nullptr;
+  wgs84.exportToWkt(&wkt);
+  dataset->SetProjection(wkt);
+  CPLFree(wkt);
+
+  GDALRasterBand *band = dataset->GetRasterBand(1);
+  if (hasNoData)
+    band->SetNoDataValue(noDataValue);
+  if (band->RasterIO(GF_Write, 0, 0, width, height, const_cast<float *>(elevations.data()), width, height, GDT_Float32, 0, 0) != CE_None)
+    throw runtime_error("Unable to fill the in-memory dataset.");
+  return dataset;
+}
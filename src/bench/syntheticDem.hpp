@@ -0,0 +1,49 @@
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <gdal_priv.h>
+
+#ifndef SYNTHETIC_DEM_H
+#define SYNTHETIC_DEM_H
+
+/**
+ * @brief Kinds of terrain the benchmarks generate.
+ */
+enum class TerrainKind
+{
+  Fractal,  // Rolling fractal terrain, many small peaks
+  Pyramids, // A field of sharp pyramids of random height, few large merges
+  Plateaus, // Fractal terrain cut into flat terraces, exercises the plateau handling
+  Ocean     // Fractal islands in a "No Data" sea
+};
+
+/**
+ * @brief An elevation raster generated in memory.
+ */
+struct SyntheticDem
+{
+  int width;
+  int height;
+  std::vector<float> elevations; // Row-major
+  bool hasNoData = false;
+  float noDataValue = -9999;
+
+  /**
+   * @brief Copies the raster into a GDAL in-memory dataset with a WGS 84 georeference, as the engines expect.
+   */
+  std::unique_ptr<GDALDataset> toDataset() const;
+};
+
+/**
+ * @brief Generates a width by height raster of the given kind. The same seed always gives the same raster.
+ */
+SyntheticDem generateDem(TerrainKind kind, int width, int height, uint32_t seed = 1);
+
+const char *terrainName(TerrainKind kind);
+/**
+ * @brief Parses a name returned by terrainName, throws std::invalid_argument for anything else.
+ */
+TerrainKind parseTerrainKind(const std::string &name);
+
+#endif // SYNTHETIC_DEM_H
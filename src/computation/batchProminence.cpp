@@ -0,0 +1,172 @@
+#include "gdal_computation.hpp"
+#include "resultSink.hpp"
+#include "../prominence/runStats.hpp"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <gdal_priv.h>
+
+using namespace std;
+
+namespace
+{
+  /**
+   * A file the reader has loaded and the sweep has not finished with yet.
+   */
+  struct LoadedRaster
+  {
+    size_t fileIndex = 0;
+    size_t bytes = 0; // Share of the memory budget the raster holds
+    unique_ptr<Transformer> transformer;
+    unique_ptr<pair<datasetMetadata, ElevationGrid>> data; // Null if the file could not be read
+    string error;
+  };
+}
+
+/**
+ * @brief Calculates peak prominences in many datasets in one process and writes them to a single output.
+ *
+ * Meant for collections of tiles that are processed independently, like the tiles of a national mosaic: the
+ * prominence of every peak is computed within its own file. To treat the files as one continuous surface,
+ * build a VRT mosaic of them and run the tiled engine on it instead.
+ *
+ * A reader thread opens and loads the files in order while the calling thread sweeps them, so the next file
+ * is read while the current one is computed. The reader only goes ahead as long as the rasters it has loaded
+ * and the one being swept fit in memoryBudget together, but always keeps at least one in flight. All sweeps
+ * share the process wide TaskPool, and GDAL is registered once for the whole batch.
+ *
+ * Files that can not be opened or read are reported and skipped. Peak coordinates in the output are pixels of
+ * the file the peak was found in, which the last column of every row names, and latitude and longitude come
+ * from that file's georeference. The output has to be CSV, the binary formats have no file column.
+ *
+ * @param inputFiles The datasets, see listInputFiles.
+ * @param outputFilePath Path of the single CSV file for all peaks. Throws std::invalid_argument for .pfc and .pfi.
+ * @param options Engine, threshold and water level settings, used for every file.
+ * @param verbose If true, progress information is printed during processing.
+ * @param stats Receives the phase timings and counters, added up over all files.
+ * @param memoryBudget Number of bytes the loaded rasters may use together.
+ */
+void calculateProminenceBatch(const vector<string> &inputFiles, const string outputFilePath, const ProminenceOptions &options, bool verbose, RunStats &stats, size_t memoryBudget)
+{
+  ResultSink output(outputFilePath, options.prominenceThreshold, nullptr, true, true);
+  mutex queueMutex;
+  condition_variable queueChanged;
+  deque<LoadedRaster> loaded;
+  size_t bytesInFlight = 0;
+  bool cancelled = false;
+
+  thread reader([&]
+                {
+                  for (size_t fileIndex = 0; fileIndex < inputFiles.size(); ++fileIndex)
+                  {
+                    LoadedRaster raster;
+                    raster.fileIndex = fileIndex;
+                    try
+                    {
+                      unique_ptr<GDALDataset> dataset(static_cast<GDALDataset *>(GDALOpen(inputFiles[fileIndex].c_str(), GA_ReadOnly)));
+                      if (!dataset)
+                        throw runtime_error("Failed to open file");
+                      GDALRasterBand *band = dataset->GetRasterBand(1);
+                      if (!band)
+                        throw runtime_error("The file has no raster band");
+                      raster.bytes = ElevationGrid::bytesFor(band->GetXSize(), band->GetYSize());
+                      {
+                        unique_lock<mutex> lock(queueMutex);
+                        queueChanged.wait(lock, [&]
+                                          { return cancelled || bytesInFlight == 0 || bytesInFlight + raster.bytes <= memoryBudget; });
+                        if (cancelled)
+                          return;
+                        bytesInFlight += raster.bytes;
+                      }
+                      if (dataset->GetProjectionRef())
+                        raster.transformer = make_unique<Transformer>(dataset.get());
+                      raster.data = make_unique<pair<datasetMetadata, ElevationGrid>>(loadRaster(dataset.get()));
+                    }
+                    catch (const exception &e)
+                    {
+                      raster.data.reset();
+                      raster.error = e.what();
+                    }
+                    lock_guard<mutex> lock(queueMutex);
+                    loaded.push_back(std::move(raster));
+                    queueChanged.notify_all();
+                  } });
+
+  uint64_t failedCount = 0;
+  try
+  {
+    for (size_t done = 0; done < inputFiles.size(); ++done)
+    {
+      // Reads overlap the sweeps, only the time spent waiting for the reader counts
+      stats.beginPhase("read");
+      LoadedRaster raster;
+      {
+        unique_lock<mutex> lock(queueMutex);
+        queueChanged.wait(lock, [&]
+                          { return !loaded.empty(); });
+        raster = std::move(loaded.front());
+        loaded.pop_front();
+      }
+      stats.endPhase();
+
+      const string &path = inputFiles[raster.fileIndex];
+      if (!raster.data)
+      {
+        cerr << raster.error << ": " << path << endl;
+        ++failedCount;
+      }
+      else
+      {
+        output.setSource(std::move(raster.transformer), path);
+        RunStats fileStats;
+        auto write = [&output](const PeakResult &peak)
+        {
+          output.write(peak);
+        };
+        if (options.engine == ProminenceEngine::UnionFind)
+          unionFindSweep(raster.data->second, options.prominenceThreshold, write, fileStats);
+        else
+          waterLevelSweep(raster.data->second, raster.data->first, options.prominenceThreshold, options.waterLevelStep, options.parallelExpansion, options.pyramidPrePass, write, fileStats);
+        fileStats.endPhase();
+        stats.add(fileStats);
+        raster.data.reset();
+      }
+
+      {
+        lock_guard<mutex> lock(queueMutex);
+        bytesInFlight -= raster.bytes;
+      }
+      queueChanged.notify_all();
+      stats.progress([&]
+                     { return "file " + to_string(done + 1) + "/" + to_string(inputFiles.size()) + " " + path + ", " + to_string(output.peakCount()) + " peaks so far"; });
+    }
+  }
+  catch (...)
+  {
+    {
+      lock_guard<mutex> lock(queueMutex);
+      cancelled = true;
+    }
+    queueChanged.notify_all();
+    reader.join();
+    throw;
+  }
+  reader.join();
+
+  stats.beginPhase("output");
+  output.close();
+  stats.endPhase();
+
+  if (verbose)
+    cout << "Found " << output.peakCount() << " peaks above the prominence threshold in " << inputFiles.size() - failedCount << " files\n";
+  stats.count("files", inputFiles.size());
+  stats.count("files_failed", failedCount);
+  stats.count("peaks_written", output.peakCount());
+}
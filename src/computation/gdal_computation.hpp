@@ -1,66 +1,23 @@
 #include <gdal_priv.h>
 #include <vector>
-#include <queue>
-#include <memory>
-#include <set>
 #include <memory>
 #include <stdexcept>
 #include <utility>
+#include <string>
+#include <cstdint>
+#include <functional>
+#include "../prominence/prominence.hpp"
+#include "peakIndex.hpp"
 
 #ifndef COMPUTATION_H
 #define COMPUTATION_H
 
-/**
- * @brief Represents simple x, y coordinates.
- *
- * Defines a 2D point with x and y integer coordinates. Includes
- * basic operations like equality and comparison for use in sets and maps.
- */
-struct Coords
-{
-  int x;
-  int y;
-  Coords(int x, int y) : x(x), y(y) {}
-  Coords() {}
-  bool operator==(const Coords &other) const
-  {
-    return x == other.x && y == other.y;
-  }
-  bool operator<(const Coords &other) const
-  {
-    if (x == other.x)
-      return y < other.y;
-    return x < other.x;
-  }
-};
-/**
- * @brief Manages island characteristics for peak prominence calculations.
- *
- * Handles the properties and interactions of an island, including its peak, edges,
- * and elevation, crucial for determining its prominence in relation to other islands.
- */
-class Island
-{
-public:
-  unsigned int id;
-  Coords peakCoords;                       // Highest point on the island
-  std::set<Coords> frontier;               // Points on the edge of the island
-  std::set<unsigned int> dominatedIslands; // Ids of other, lower, islands that this Island has come in contact with.
-  bool flaggedForDeletion;                 // If dominated by another island, set to true and delete it from the vector when we next see it.
-  double elevation;
-  double prominence;
-
-  Island(const Coords &peakCoords, double elevation) : peakCoords(peakCoords), elevation(elevation), flaggedForDeletion(false)
-  {
-    frontier.insert(peakCoords);
-  }
-};
 /**
  * @brief Custom deleter for OGRSpatialReference objects.
  *
  *
  */
-auto OGRSpatialReferenceDeleter = [](OGRSpatialReference *ptr)
+inline auto OGRSpatialReferenceDeleter = [](OGRSpatialReference *ptr)
 {
   if (ptr)
     OGRSpatialReference::DestroySpatialReference(ptr);
@@ -71,7 +28,7 @@ auto OGRSpatialReferenceDeleter = [](OGRSpatialReference *ptr)
  * Manages the destruction of OGRCoordinateTransformation objects,
  * preventing memory leaks by correctly freeing allocated resources.
  */
-auto OGRCoordinateTransformationDeleter = [](OGRCoordinateTransformation *ptr)
+inline auto OGRCoordinateTransformationDeleter = [](OGRCoordinateTransformation *ptr)
 {
   if (ptr)
     OCTDestroyCoordinateTransformation(ptr);
@@ -80,11 +37,12 @@ auto OGRCoordinateTransformationDeleter = [](OGRCoordinateTransformation *ptr)
  * @brief Handles coordinate transformations for geographic data.
  *
  * Responsible for converting coordinates between different spatial
- * reference systems using GDAL functionalities.
+ * reference systems using GDAL functionalities. OGR transformations are
+ * not thread safe, so every thread that transforms needs its own Transformer.
  */
 struct Transformer
 {
-  std::unique_ptr<OGRCoordinateTransformation, decltype(OGRCoordinateTransformationDeleter)> transformation;
+  std::unique_ptr<OGRCoordinateTransformation, decltype(OGRCoordinateTransformationDeleter)> transformation; // Null if the dataset already is in EPSG:4326
   double adfGeoTransform[6];
 
   explicit Transformer(GDALDataset *dataset)
@@ -98,6 +56,20 @@ struct Transformer
     auto sourceSRS = std::unique_ptr<OGRSpatialReference, decltype(OGRSpatialReferenceDeleter)>(
         new OGRSpatialReference(wkt), OGRSpatialReferenceDeleter);
 
+    if (dataset->GetGeoTransform(adfGeoTransform) != CE_None)
+    {
+      throw std::runtime_error("Failed to get GeoTransform.");
+    }
+
+    // Latitude and longitude can be read straight off the geotransform, no need to go through PROJ
+    const char *authorityName = sourceSRS->GetAuthorityName(nullptr);
+    const char *authorityCode = sourceSRS->GetAuthorityCode(nullptr);
+    if (sourceSRS->IsGeographic() && authorityName && authorityCode &&
+        std::string(authorityName) == "EPSG" && std::string(authorityCode) == "4326")
+    {
+      return;
+    }
+
     auto targetSRS = std::unique_ptr<OGRSpatialReference, decltype(OGRSpatialReferenceDeleter)>(
         new OGRSpatialReference(), OGRSpatialReferenceDeleter);
     targetSRS->importFromEPSG(4326);
@@ -109,112 +81,162 @@ struct Transformer
     {
       throw std::runtime_error("Failed to create coordinate transformation.");
     }
-
-    if (dataset->GetGeoTransform(adfGeoTransform) != CE_None)
-    {
-      throw std::runtime_error("Failed to get GeoTransform.");
-    }
   }
   /**
-   * @brief Transforms dataset indexes to latitude and longitude coordinates
+   * @brief Transforms a batch of dataset indexes to latitude and longitude coordinates
+   *
+   * The geotransform is applied in one pass over the batch and the whole batch then goes through a
+   * single PROJ call, which is far cheaper than transforming points one at a time.
    *
-   * @param pixelX
-   * @param pixelY
-   * @return std::pair<double, double>
+   * @param count Number of points
+   * @param pixelX Column of every point
+   * @param pixelY Row of every point
+   * @param latitude Receives the latitude of every point
+   * @param longitude Receives the longitude of every point
    */
-  std::pair<double, double> transform(int pixelX, int pixelY)
+  void transform(size_t count, const int *pixelX, const int *pixelY, double *latitude, double *longitude)
   {
-    double x = adfGeoTransform[0] + pixelX * adfGeoTransform[1] + pixelY * adfGeoTransform[2];
-    double y = adfGeoTransform[3] + pixelX * adfGeoTransform[4] + pixelY * adfGeoTransform[5];
+    const double originX = adfGeoTransform[0], xPerColumn = adfGeoTransform[1], xPerRow = adfGeoTransform[2];
+    const double originY = adfGeoTransform[3], yPerColumn = adfGeoTransform[4], yPerRow = adfGeoTransform[5];
+    // The target uses the EPSG axis order, so PROJ turns x into latitude and y into longitude in place.
+    // The geotransform of an EPSG:4326 dataset gives longitude in x and latitude in y
+    double *xs = transformation ? latitude : longitude;
+    double *ys = transformation ? longitude : latitude;
+    for (size_t i = 0; i < count; ++i)
+    {
+      double column = pixelX[i];
+      double row = pixelY[i];
+      xs[i] = originX + column * xPerColumn + row * xPerRow;
+      ys[i] = originY + column * yPerColumn + row * yPerRow;
+    }
 
-    if (!transformation->Transform(1, &x, &y))
+    if (transformation && count > 0 && !transformation->Transform(count, xs, ys))
     {
       throw std::runtime_error("Failed to transform coordinates.");
     }
-
-    return std::make_pair(x, y);
   }
 };
 /**
- * @brief Represents a point with elevation and island association data.
+ * @brief A cell a tile hands over to the stitching step of the tiled engine.
  *
- * Stores the elevation of a point and its association with an island,
- * if any. It includes methods to determine island affiliation.
+ * Either a cell on the edge shared with a neighbouring tile, a peak whose component reached such an
+ * edge before it merged with a higher peak, or a saddle where two such components joined. Together
+ * with parent these nodes form the tile's merge tree reduced to what other tiles can influence.
  */
-struct Point
+struct BoundaryNode
 {
-  unsigned int islandId;
-  double elevation;
-
-  Point() : elevation(0.0) {}
-  Point(double elevation) : elevation(elevation) {}
-  Point(double elevation, unsigned int islandId) : elevation(elevation), islandId(islandId) {}
-
-  bool belongsToAnyIsland() const
-  {
-    return islandId != 0;
-  }
-
-  bool belongsToIsland(const Point &other) const
-  {
-    return islandId == other.islandId;
-  }
+  uint64_t cell;   // Global index y * width + x of the cell in the dataset
+  float elevation; // Elevation of the cell
+  uint32_t parent; // Index of the lower node this one joined in the tile, PeakForest::NONE if it never did
+  bool onTileEdge; // True if the cell has neighbours in another tile
 };
 /**
- * @brief Comparator for island elevation.
- *
- * Defines a comparison rule for islands based on their elevation, used in findPeakIslands to sort the vector based on height
+ * @brief Output of sweeping a single tile.
  *
+ * Peaks that merged with a higher peak before their component reached the tile edge are final and
+ * stored in resolvedPeaks, or in pendingPeaks if the higher component had reached the edge and their
+ * parent can only be found by stitching. Everything else is described by the reduced merge tree in boundaryTree.
  */
-struct CompareIsland
+struct TileResult
 {
-  bool operator()(const std::unique_ptr<Island> &a, const std::unique_ptr<Island> &b) const
+  /**
+   * @brief A resolved peak whose component had reached the tile edge by its key col, so a higher peak in another
+   * tile may be its parent. Node is the boundary tree node its component continued in.
+   */
+  struct PendingPeak
   {
-    return a->elevation < b->elevation;
-  }
+    PeakResult peak;
+    uint32_t node;
+  };
+  std::vector<PeakResult> resolvedPeaks;
+  std::vector<PendingPeak> pendingPeaks;
+  std::vector<BoundaryNode> boundaryTree;
+};
+/**
+ * @brief Working arrays of processTile, kept by every sweepTiles worker from one tile to the next.
+ *
+ * A tile reuses the memory of the tile before instead of allocating, and faulting in, some 20 bytes per cell
+ * afresh. The arrays are released when the worker finishes.
+ */
+struct TileScratch
+{
+  std::vector<uint32_t> order;  // Cells of the tile, highest first
+  std::vector<uint32_t> anchor; // Lowest kept node of every anchored component
+  PeakForest forest;
 };
 /**
- * @brief Stores key col information for island interactions.
+ * @brief Everything a tiled run knows about its tiles, saved with -state and read back by updateProminenceTiled.
  *
- * Contains data about the key col (lowest point) in the interaction
- * between two islands, including the other island's reference and
- * the col elevation and coordinates. Used in the main water level loop
+ * Holds the layout the tiles were cut with and the TileResult of every tile, resolved peaks included, so the
+ * previous peaks can be rebuilt by stitching again and a tile only has to be swept again when its cells change.
  */
-struct KeyColInfo
+struct TileState
 {
-  std::shared_ptr<Island> otherIsland;
-  double colElevation;
-  Coords colCoords;
-  bool found;
-  KeyColInfo(){};
+  int datasetWidth;
+  int datasetHeight;
+  int tileWidth;
+  int tileHeight;
+  int prominenceThreshold;
+  std::vector<TileResult> tiles; // Row by row
 };
 /**
- * @brief Holds metadata for the dataset.
+ * @brief Read only memory map of the pixel data of an uncompressed float32 GeoTIFF.
  *
- * Encapsulates important information about the dataset, such as
- * maximum and minimum elevations, and the dataset's dimensions.
+ * Lets loadRasterWindow copy strips or tiles straight from the page cache into an ElevationGrid, instead of
+ * going through RasterIO and the GDAL block cache. Only files whose pixels are stored as plain little endian
+ * float32 values in a single band qualify, see open().
  */
-struct datasetMetadata
+class MappedRaster
 {
-  double maxElevation;
-  double minElevation;
-  int height;
-  int width;
-  datasetMetadata(double maxElevation, double minElevation, int height, int width)
-      : maxElevation(maxElevation), minElevation(minElevation), height(height), width(width) {}
+public:
+  /**
+   * @brief Maps the file behind dataset if its layout allows it.
+   *
+   * @return The mapping, or null if the file is compressed, not float32, interleaved, sparse, not a local
+   * file or otherwise unsuitable. Callers then fall back to RasterIO.
+   */
+  static std::unique_ptr<MappedRaster> open(GDALDataset *dataset);
+  ~MappedRaster();
+  MappedRaster(const MappedRaster &) = delete;
+  MappedRaster &operator=(const MappedRaster &) = delete;
+
+  /**
+   * @brief Copies a window of the raster into rows that are stride values apart.
+   */
+  void readWindow(int xOffset, int yOffset, int width, int height, float *destination, size_t stride) const;
+
+private:
+  MappedRaster() = default;
+
+  const unsigned char *data = nullptr;
+  size_t fileSize = 0;
+  int blockWidth = 0;
+  int blockHeight = 0;
+  int blocksPerRow = 0;
+  std::vector<uint64_t> blockOffsets; // File offset of every strip or tile, row by row
 };
 
 // Functions defined in their own files
 
-void calculateProminence(std::unique_ptr<GDALDataset> &dataset, std::string outputFilePath, int prominenceThreshold, bool verbose);
+void calculateProminence(std::unique_ptr<GDALDataset> &dataset, std::string outputFilePath, int prominenceThreshold, bool verbose, RunStats &stats, double waterLevelStep = 1, bool parallelExpansion = true, bool pyramidPrePass = false);
+void calculateProminenceUnionFind(std::unique_ptr<GDALDataset> &dataset, std::string outputFilePath, int prominenceThreshold, bool verbose, RunStats &stats);
+void calculateProminenceBatch(const std::vector<std::string> &inputFiles, std::string outputFilePath, const ProminenceOptions &options, bool verbose, RunStats &stats, size_t memoryBudget);
+std::vector<std::string> listInputFiles(const std::string &input);
+size_t queryPeakIndex(const std::string &indexFilePath, const std::string &outputFilePath, double prominenceThreshold, const PeakIndex::Box &box);
+void calculateProminenceTiled(std::unique_ptr<GDALDataset> &dataset, std::string outputFilePath, int prominenceThreshold, bool verbose, RunStats &stats, int tileSize, size_t tileMemoryBudget,
+                              const std::string &stateFilePath = "");
+void updateProminenceTiled(std::unique_ptr<GDALDataset> &dataset, const std::string &stateFilePath, int windowX, int windowY, int windowWidth, int windowHeight,
+                           std::string outputFilePath, bool verbose, RunStats &stats, size_t tileMemoryBudget);
+void checkTileSize(int tileWidth, int tileHeight);
+void sweepTiles(GDALDataset *dataset, const std::vector<size_t> &tileIndices, int tileWidth, int tileHeight, int prominenceThreshold, size_t tileMemoryBudget,
+                const std::function<void(size_t, TileResult &)> &onTile, bool verbose);
+void writeTileState(const std::string &filename, const TileState &state);
+TileState readTileState(const std::string &filename);
+TileResult processTile(const ElevationGrid &tile, int xOffset, int yOffset, int datasetWidth, int datasetHeight, int prominenceThreshold, TileScratch &scratch);
+std::vector<PeakResult> stitchTiles(const std::vector<TileResult> &tiles, int datasetWidth, int datasetHeight, int tileWidth, int tileHeight, int prominenceThreshold);
 void printMetaData(GDALDataset *dataset);
-std::vector<Coords> neighbors(Coords coords, int datasetHeight, int datasetWidth);
-std::vector<std::shared_ptr<Island>> findPeakIslands(GDALDataset *dataset);
-std::pair<datasetMetadata, std::vector<std::vector<Point>>> initializeMatrix(GDALDataset *dataset);
-void processKeyCol(Island &island1, Island &island2, double colElevation, std::vector<std::vector<Point>> &pointMatrix);
-std::shared_ptr<Island> getIslandIfExists(const std::map<unsigned int, std::shared_ptr<Island>> &map, unsigned int key);
+std::pair<datasetMetadata, ElevationGrid> loadRaster(GDALDataset *dataset);
+std::pair<datasetMetadata, ElevationGrid> loadRasterWindow(GDALDataset *dataset, int xOffset, int yOffset, int width, int height, const MappedRaster *mapping = nullptr);
 std::pair<double, double> PixelToLatLon(GDALDataset *dataset, int pixelX, int pixelY);
-void appendIslandDataToFile(const std::shared_ptr<Island> &island, const std::string &filename, const std::unique_ptr<Transformer> &transformerPtr);
-void initializeCSV(const std::string &filename);
 
-#endif // COMPUTATION_H
\ No newline at end of file
+#endif // COMPUTATION_H
@@ -0,0 +1,55 @@
+#include "gdal_computation.hpp"
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <glob.h>
+
+using namespace std;
+
+/**
+ * @brief Expands the input argument of the command line into the files to process.
+ *
+ * A pattern containing *, ? or [ is expanded with glob, in sorted order. A file ending in .txt or .list is read
+ * as a list of files, one per line; empty lines and lines starting with # are skipped, and relative paths are
+ * taken relative to the list. Anything else, including a VRT mosaic, is a single dataset.
+ *
+ * @param input The input argument.
+ * @return The files, empty if a pattern matches nothing.
+ */
+vector<string> listInputFiles(const string &input)
+{
+  if (input.find_first_of("*?[") != string::npos)
+  {
+    glob_t matches;
+    vector<string> files;
+    if (glob(input.c_str(), 0, nullptr, &matches) == 0)
+    {
+      for (size_t i = 0; i < matches.gl_pathc; ++i)
+        files.emplace_back(matches.gl_pathv[i]);
+    }
+    globfree(&matches);
+    return files;
+  }
+
+  filesystem::path inputPath(input);
+  if (inputPath.extension() != ".txt" && inputPath.extension() != ".list")
+    return {input};
+
+  ifstream list(input);
+  if (!list.is_open())
+    throw runtime_error("Unable to open file list: " + input);
+  vector<string> files;
+  string line;
+  while (getline(list, line))
+  {
+    size_t begin = line.find_first_not_of(" \t\r");
+    if (begin == string::npos || line[begin] == '#')
+      continue;
+    size_t end = line.find_last_not_of(" \t\r");
+    filesystem::path file(line.substr(begin, end - begin + 1));
+    files.push_back(file.is_absolute() ? file.string() : (inputPath.parent_path() / file).string());
+  }
+  return files;
+}
@@ -0,0 +1,82 @@
+#include "gdal_computation.hpp"
+#include <gdal_priv.h>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * @brief Loads a rectangular window of the elevation band into an ElevationGrid.
+ *
+ * Reads the window in chunks of whole GDAL block rows straight into the rows of the grid. While a
+ * chunk is still in cache maskNoData computes the minimum and maximum elevation and replaces
+ * "No Data" values with -infinity, so every later stage sees them as permanently below the water level.
+ * With a mapping the chunks are copied straight out of the mapped file instead of going through RasterIO.
+ *
+ * @param dataset Pointer to the dataset being analyzed.
+ * @param xOffset Column of the dataset where the window starts.
+ * @param yOffset Row of the dataset where the window starts.
+ * @param width Width of the window.
+ * @param height Height of the window.
+ * @param mapping Memory map of the dataset from MappedRaster::open, or null to read through RasterIO.
+ * @return Pair containing metadata of the window and the loaded ElevationGrid.
+ */
+pair<datasetMetadata, ElevationGrid> loadRasterWindow(GDALDataset *dataset, int xOffset, int yOffset, int width, int height, const MappedRaster *mapping)
+{
+  GDALRasterBand *band = dataset->GetRasterBand(1);
+  int hasNoData;
+  double noDataValue = band->GetNoDataValue(&hasNoData);
+  float noDataFloat = float(noDataValue);
+
+  // Read whole blocks at a time so compressed tiles or strips are only decoded once
+  int blockXSize, blockYSize;
+  band->GetBlockSize(&blockXSize, &blockYSize);
+  int rowsPerChunk = max(blockYSize, 1);
+
+  ElevationGrid grid(width, height);
+  double maxElevation = -INFINITY;
+  double minElevation = INFINITY;
+  for (int startRow = 0; startRow < height; startRow += rowsPerChunk)
+  {
+    int rowCount = min(rowsPerChunk, height - startRow);
+    if (mapping)
+    {
+      mapping->readWindow(xOffset, yOffset + startRow, width, rowCount, grid.row(startRow), grid.stride);
+    }
+    else
+    {
+      auto err = band->RasterIO(GF_Read, xOffset, yOffset + startRow, width, rowCount, grid.row(startRow), width, rowCount, GDT_Float32,
+                                sizeof(float), GSpacing(grid.stride * sizeof(float)));
+      if (err)
+      {
+        cerr << "Error reading band: " << err << '\n';
+      }
+    }
+    maskNoData(grid, startRow, rowCount, hasNoData != 0, noDataFloat, minElevation, maxElevation);
+  }
+  // A window with nothing but "No Data" has no elevation range
+  if (maxElevation < minElevation)
+  {
+    maxElevation = minElevation = 0;
+  }
+  return make_pair(datasetMetadata(maxElevation, minElevation, height, width, hasNoData != 0, noDataValue), std::move(grid));
+}
+
+/**
+ * @brief Loads the elevation band of the dataset into an ElevationGrid.
+ *
+ * This is the only place the raster is decoded for the in-memory engines. Band 1 is read once, see
+ * loadRasterWindow, and peak detection and the prominence engines all work on the returned grid
+ * without further copies. Uncompressed float32 GeoTIFFs are copied straight from a memory map of the
+ * file, see MappedRaster.
+ *
+ * @param dataset Pointer to the dataset being analyzed.
+ * @return Pair containing dataset metadata and the loaded ElevationGrid.
+ */
+pair<datasetMetadata, ElevationGrid> loadRaster(GDALDataset *dataset)
+{
+  GDALRasterBand *band = dataset->GetRasterBand(1);
+  auto mapping = MappedRaster::open(dataset);
+  return loadRasterWindow(dataset, 0, 0, band->GetXSize(), band->GetYSize(), mapping.get());
+}
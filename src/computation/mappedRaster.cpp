@@ -0,0 +1,136 @@
+#include "gdal_computation.hpp"
+#include <gdal_priv.h>
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+  // Reads an integer item of the TIFF metadata domain, 0 if it is missing
+  uint64_t tiffMetadataNumber(GDALRasterBand *band, const char *item, int blockColumn, int blockRow)
+  {
+    char name[64];
+    snprintf(name, sizeof(name), "%s_%d_%d", item, blockColumn, blockRow);
+    const char *value = band->GetMetadataItem(name, "TIFF");
+    return value ? strtoull(value, nullptr, 10) : 0;
+  }
+}
+
+unique_ptr<MappedRaster> MappedRaster::open(GDALDataset *dataset)
+{
+  if constexpr (endian::native != endian::little)
+    return nullptr;
+
+  GDALDriver *driver = dataset->GetDriver();
+  if (!driver || string(driver->GetDescription()) != "GTiff" || dataset->GetRasterCount() != 1)
+    return nullptr;
+  GDALRasterBand *band = dataset->GetRasterBand(1);
+  if (band->GetRasterDataType() != GDT_Float32)
+    return nullptr;
+  const char *compression = dataset->GetMetadataItem("COMPRESSION", "IMAGE_STRUCTURE");
+  if (compression && string(compression) != "NONE")
+    return nullptr;
+
+  int fd = ::open(dataset->GetDescription(), O_RDONLY);
+  if (fd < 0)
+    return nullptr; // Not a local file, e.g. one of GDAL's virtual file systems
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size < 8)
+  {
+    ::close(fd);
+    return nullptr;
+  }
+  void *mapped = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED)
+    return nullptr;
+
+  unique_ptr<MappedRaster> raster(new MappedRaster());
+  raster->data = static_cast<const unsigned char *>(mapped);
+  raster->fileSize = size_t(info.st_size);
+  // Big endian TIFFs start with "MM" and would need every value byte swapped
+  if (memcmp(raster->data, "II", 2) != 0)
+    return nullptr;
+
+  int width = band->GetXSize();
+  int height = band->GetYSize();
+  band->GetBlockSize(&raster->blockWidth, &raster->blockHeight);
+  if (raster->blockWidth <= 0 || raster->blockHeight <= 0)
+    return nullptr;
+  raster->blocksPerRow = (width + raster->blockWidth - 1) / raster->blockWidth;
+  int blockRows = (height + raster->blockHeight - 1) / raster->blockHeight;
+
+  // Every block has to be present and hold at least the rows of the raster it covers
+  raster->blockOffsets.reserve(size_t(raster->blocksPerRow) * blockRows);
+  for (int blockRow = 0; blockRow < blockRows; ++blockRow)
+  {
+    uint64_t usedBytes = uint64_t(raster->blockWidth) * min(raster->blockHeight, height - blockRow * raster->blockHeight) * sizeof(float);
+    for (int blockColumn = 0; blockColumn < raster->blocksPerRow; ++blockColumn)
+    {
+      uint64_t offset = tiffMetadataNumber(band, "BLOCK_OFFSET", blockColumn, blockRow);
+      uint64_t size = tiffMetadataNumber(band, "BLOCK_SIZE", blockColumn, blockRow);
+      if (offset == 0 || size < usedBytes || offset + usedBytes > raster->fileSize)
+        return nullptr; // Sparse file or a layout we do not understand
+      raster->blockOffsets.push_back(offset);
+    }
+  }
+
+  // Full width strips are read front to back, tiles are prefetched by readWindow instead
+  if (raster->blockWidth >= width)
+    madvise(mapped, raster->fileSize, MADV_SEQUENTIAL);
+  return raster;
+}
+
+MappedRaster::~MappedRaster()
+{
+  if (data)
+    munmap(const_cast<unsigned char *>(data), fileSize);
+}
+
+void MappedRaster::readWindow(int xOffset, int yOffset, int width, int height, float *destination, size_t stride) const
+{
+  const size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+  int firstBlockColumn = xOffset / blockWidth;
+  int lastBlockColumn = (xOffset + width - 1) / blockWidth;
+  int lastBlockRow = int(blockOffsets.size() / blocksPerRow) - 1;
+  int prefetchedBlockRow = -1;
+
+  for (int row = 0; row < height; ++row)
+  {
+    int y = yOffset + row;
+    int blockRow = y / blockHeight;
+    size_t rowInBlock = size_t(y % blockHeight);
+
+    // Ask the kernel to start reading the blocks of the window's next block row while this one is copied
+    if (blockRow + 1 <= lastBlockRow && blockRow + 1 > prefetchedBlockRow && y + blockHeight - int(rowInBlock) < yOffset + height)
+    {
+      prefetchedBlockRow = blockRow + 1;
+      for (int blockColumn = firstBlockColumn; blockColumn <= lastBlockColumn; ++blockColumn)
+      {
+        size_t start = blockOffsets[size_t(prefetchedBlockRow) * blocksPerRow + blockColumn];
+        size_t alignedStart = start / pageSize * pageSize;
+        size_t end = min(fileSize, start + size_t(blockWidth) * blockHeight * sizeof(float));
+        madvise(const_cast<unsigned char *>(data) + alignedStart, end - alignedStart, MADV_WILLNEED);
+      }
+    }
+
+    float *out = destination + size_t(row) * stride;
+    for (int x = xOffset; x < xOffset + width;)
+    {
+      int blockColumn = x / blockWidth;
+      int columnInBlock = x % blockWidth;
+      int count = min(blockWidth - columnInBlock, xOffset + width - x);
+      size_t offset = blockOffsets[size_t(blockRow) * blocksPerRow + blockColumn] + (rowInBlock * blockWidth + columnInBlock) * sizeof(float);
+      memcpy(out + (x - xOffset), data + offset, size_t(count) * sizeof(float));
+      x += count;
+    }
+  }
+}
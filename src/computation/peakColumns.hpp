@@ -0,0 +1,195 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef PEAK_COLUMNS_H
+#define PEAK_COLUMNS_H
+
+/**
+ * @brief Layout of the binary columnar peak format, written by ResultSink for output files ending in .pfc.
+ *
+ * All values are little endian.
+ *
+ *     header     "PEAKCOLS", uint32 version, uint32 rows per full row group
+ *     row group  uint32 row count, uint32 reserved, then one column after the other:
+ *                x int32, y int32, elevation f64, prominence f64, latitude f64, longitude f64,
+ *                col x int32, col y int32, col elevation f64, parent x int32, parent y int32
+ *     ...
+ *     footer     uint64 offset of every row group, uint64 row group count, uint64 row count, "PEAKCOLS"
+ *
+ * Every column is padded to a multiple of 8 bytes, so all columns of a memory mapped file are aligned and
+ * can be scanned in place. Latitude and longitude are NaN when the dataset has no projection, and the col
+ * columns are (-1, -1) and NaN for peaks that are the highest point of their landmass. The parent is the peak
+ * of the island the row's peak joins at its key col, (-1, -1) for the highest point of a landmass; following
+ * the parents from any row leads through rows of the same file up to that highest point.
+ *
+ * Version 1 files end every row group after the col elevation, they can still be read.
+ */
+struct PeakColumns
+{
+  static constexpr char MAGIC[8] = {'P', 'E', 'A', 'K', 'C', 'O', 'L', 'S'};
+  static constexpr uint32_t VERSION = 2;
+  static constexpr uint32_t ROW_GROUP_SIZE = 65536;
+  static constexpr size_t HEADER_BYTES = 16;
+  static constexpr size_t ROW_GROUP_HEADER_BYTES = 8;
+  static constexpr size_t FOOTER_BYTES = 24; // Without the row group offsets
+
+  /**
+   * @brief Bytes one column of rowCount values takes up, including its padding.
+   */
+  static constexpr size_t columnBytes(size_t rowCount, size_t valueSize)
+  {
+    return (rowCount * valueSize + 7) / 8 * 8;
+  }
+};
+
+/**
+ * @brief Read only, memory mapped view of a .pfc peak file.
+ *
+ * Self contained so that the format can be read and checked without GDAL. Throws std::runtime_error if the
+ * file can not be opened or is not a valid peak file.
+ */
+class PeakColumnsReader
+{
+public:
+  /**
+   * @brief Pointers to the columns of one row group, valid as long as the reader is.
+   */
+  struct RowGroup
+  {
+    size_t rowCount;
+    const int32_t *x;
+    const int32_t *y;
+    const double *elevation;
+    const double *prominence;
+    const double *latitude;
+    const double *longitude;
+    const int32_t *colX;
+    const int32_t *colY;
+    const double *colElevation;
+    const int32_t *parentX; // Null in version 1 files
+    const int32_t *parentY; // Null in version 1 files
+  };
+
+  explicit PeakColumnsReader(const std::string &filename)
+  {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("Unable to open " + filename);
+    struct stat info;
+    if (fstat(fd, &info) != 0 || size_t(info.st_size) < PeakColumns::HEADER_BYTES + PeakColumns::FOOTER_BYTES)
+    {
+      ::close(fd);
+      throw std::runtime_error(filename + " is not a peak column file");
+    }
+    fileSize = size_t(info.st_size);
+    void *mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+      throw std::runtime_error("Unable to map " + filename);
+    data = static_cast<const unsigned char *>(mapped);
+
+    try
+    {
+      parse(filename);
+    }
+    catch (...)
+    {
+      munmap(const_cast<unsigned char *>(data), fileSize);
+      throw;
+    }
+  }
+  ~PeakColumnsReader()
+  {
+    munmap(const_cast<unsigned char *>(data), fileSize);
+  }
+  PeakColumnsReader(const PeakColumnsReader &) = delete;
+  PeakColumnsReader &operator=(const PeakColumnsReader &) = delete;
+
+  size_t rowCount() const
+  {
+    return totalRows;
+  }
+  size_t rowGroupCount() const
+  {
+    return rowGroups.size();
+  }
+  const RowGroup &rowGroup(size_t index) const
+  {
+    return rowGroups[index];
+  }
+
+private:
+  const unsigned char *data = nullptr;
+  size_t fileSize = 0;
+  size_t totalRows = 0;
+  std::vector<RowGroup> rowGroups;
+
+  template <typename T>
+  T read(size_t offset) const
+  {
+    T value;
+    std::memcpy(&value, data + offset, sizeof(T));
+    return value;
+  }
+
+  void parse(const std::string &filename)
+  {
+    const std::runtime_error invalid(filename + " is not a valid peak column file");
+    size_t footer = fileSize - PeakColumns::FOOTER_BYTES;
+    if (std::memcmp(data, PeakColumns::MAGIC, 8) != 0 || std::memcmp(data + footer + 16, PeakColumns::MAGIC, 8) != 0)
+      throw invalid;
+    uint32_t version = read<uint32_t>(8);
+    if (version == 0 || version > PeakColumns::VERSION)
+      throw std::runtime_error(filename + " has an unsupported peak column version");
+
+    uint64_t groupCount = read<uint64_t>(footer);
+    totalRows = read<uint64_t>(footer + 8);
+    if (groupCount > footer / 8 || footer - groupCount * 8 < PeakColumns::HEADER_BYTES)
+      throw invalid;
+    size_t offsets = footer - groupCount * 8;
+
+    size_t rowsSeen = 0;
+    for (uint64_t group = 0; group < groupCount; ++group)
+    {
+      size_t offset = read<uint64_t>(offsets + group * 8);
+      if (offset % 8 != 0 || offset < PeakColumns::HEADER_BYTES || offset + PeakColumns::ROW_GROUP_HEADER_BYTES > offsets)
+        throw invalid;
+      RowGroup rows;
+      rows.rowCount = read<uint32_t>(offset);
+      size_t column = offset + PeakColumns::ROW_GROUP_HEADER_BYTES;
+      auto next = [&](size_t valueSize)
+      {
+        const unsigned char *start = data + column;
+        column += PeakColumns::columnBytes(rows.rowCount, valueSize);
+        return start;
+      };
+      rows.x = reinterpret_cast<const int32_t *>(next(4));
+      rows.y = reinterpret_cast<const int32_t *>(next(4));
+      rows.elevation = reinterpret_cast<const double *>(next(8));
+      rows.prominence = reinterpret_cast<const double *>(next(8));
+      rows.latitude = reinterpret_cast<const double *>(next(8));
+      rows.longitude = reinterpret_cast<const double *>(next(8));
+      rows.colX = reinterpret_cast<const int32_t *>(next(4));
+      rows.colY = reinterpret_cast<const int32_t *>(next(4));
+      rows.colElevation = reinterpret_cast<const double *>(next(8));
+      rows.parentX = version >= 2 ? reinterpret_cast<const int32_t *>(next(4)) : nullptr;
+      rows.parentY = version >= 2 ? reinterpret_cast<const int32_t *>(next(4)) : nullptr;
+      if (column > offsets)
+        throw invalid;
+      rowsSeen += rows.rowCount;
+      rowGroups.push_back(rows);
+    }
+    if (rowsSeen != totalRows)
+      throw invalid;
+  }
+};
+
+#endif // PEAK_COLUMNS_H
@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef PEAK_INDEX_H
+#define PEAK_INDEX_H
+
+/**
+ * @brief Layout of the binary peak index, written by ResultSink for output files ending in .pfi.
+ *
+ * All values are little endian.
+ *
+ *     header   "PEAKINDX", uint32 version, uint32 grid size G, uint64 peak count,
+ *              f64 min longitude, f64 min latitude, f64 max longitude, f64 max latitude,
+ *              f64 prominence threshold of the run, so only peaks above it are in the index
+ *     cells    uint64 index of the first record of every grid cell, G * G cells row by row from the south west,
+ *              then the cell of peaks without coordinates, then the peak count
+ *     records  one Record per peak, ordered by cell and within a cell by descending prominence
+ *
+ * The grid splits the bounding box of all peaks into G by G cells of equal size in longitude and latitude.
+ * A query only visits the cells that overlap its box, and in each of them stops at the first record at or
+ * below its prominence threshold, so it never looks at more than the peaks it returns plus one per cell.
+ *
+ * Version 1 files have a reserved zero in place of the threshold and are read with an unknown threshold.
+ */
+struct PeakIndex
+{
+  static constexpr char MAGIC[8] = {'P', 'E', 'A', 'K', 'I', 'N', 'D', 'X'};
+  static constexpr uint32_t VERSION = 2;
+  static constexpr size_t HEADER_BYTES = 64;
+  static constexpr uint32_t MAX_GRID_SIZE = 1024;
+  static constexpr size_t PEAKS_PER_CELL = 64; // Average the grid size is chosen for
+
+  /**
+   * @brief Everything the index stores about a peak, 64 bytes.
+   */
+  struct Record
+  {
+    double prominence;
+    double elevation;
+    double latitude;     // NaN if the dataset has no projection
+    double longitude;    // NaN if the dataset has no projection
+    double colElevation; // NaN for the highest peak of a landmass
+    int32_t x;
+    int32_t y;
+    int32_t colX;    // -1 for the highest peak of a landmass
+    int32_t colY;    // -1 for the highest peak of a landmass
+    int32_t parentX; // Peak this one merged into at its key col, -1 for the highest peak of a landmass
+    int32_t parentY;
+  };
+  static_assert(sizeof(Record) == 64, "Index records are 64 bytes");
+
+  /**
+   * @brief Area a query is restricted to, in degrees.
+   */
+  struct Box
+  {
+    double minLongitude = -INFINITY;
+    double minLatitude = -INFINITY;
+    double maxLongitude = INFINITY;
+    double maxLatitude = INFINITY;
+
+    bool everywhere() const
+    {
+      return std::isinf(minLongitude) && std::isinf(minLatitude) && std::isinf(maxLongitude) && std::isinf(maxLatitude);
+    }
+    bool contains(double longitude, double latitude) const
+    {
+      return longitude >= minLongitude && longitude <= maxLongitude && latitude >= minLatitude && latitude <= maxLatitude;
+    }
+  };
+
+  /**
+   * @brief Sorts the records into the grid and returns the whole index file.
+   *
+   * @param records Every peak the run found above prominenceThreshold.
+   * @param prominenceThreshold Threshold of the run, queries below it would miss peaks.
+   */
+  static std::string encode(std::vector<Record> records, double prominenceThreshold)
+  {
+    Box bounds{INFINITY, INFINITY, -INFINITY, -INFINITY};
+    for (const Record &record : records)
+    {
+      if (std::isnan(record.latitude) || std::isnan(record.longitude))
+        continue;
+      bounds.minLongitude = std::min(bounds.minLongitude, record.longitude);
+      bounds.minLatitude = std::min(bounds.minLatitude, record.latitude);
+      bounds.maxLongitude = std::max(bounds.maxLongitude, record.longitude);
+      bounds.maxLatitude = std::max(bounds.maxLatitude, record.latitude);
+    }
+    if (bounds.minLongitude > bounds.maxLongitude)
+      bounds = Box{0, 0, 0, 0};
+    uint32_t gridSize = uint32_t(std::clamp<double>(std::ceil(std::sqrt(double(records.size()) / PEAKS_PER_CELL)), 1, MAX_GRID_SIZE));
+    size_t cellCount = size_t(gridSize) * gridSize + 1;
+
+    std::vector<uint32_t> recordCells(records.size());
+    std::vector<uint64_t> cellStarts(cellCount + 1, 0);
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+      recordCells[i] = cellOf(bounds, gridSize, records[i].longitude, records[i].latitude);
+      ++cellStarts[recordCells[i] + 1];
+    }
+    for (size_t cell = 0; cell < cellCount; ++cell)
+      cellStarts[cell + 1] += cellStarts[cell];
+
+    std::vector<Record> sorted(records.size());
+    std::vector<uint64_t> fill(cellStarts.begin(), cellStarts.end() - 1);
+    for (size_t i = 0; i < records.size(); ++i)
+      sorted[fill[recordCells[i]]++] = records[i];
+    for (size_t cell = 0; cell < cellCount; ++cell)
+    {
+      std::stable_sort(sorted.begin() + ptrdiff_t(cellStarts[cell]), sorted.begin() + ptrdiff_t(cellStarts[cell + 1]), [](const Record &a, const Record &b)
+                       { return a.prominence > b.prominence; });
+    }
+
+    std::string file;
+    file.reserve(HEADER_BYTES + cellStarts.size() * sizeof(uint64_t) + sorted.size() * sizeof(Record));
+    uint32_t header[2] = {VERSION, gridSize};
+    uint64_t peakCount = sorted.size();
+    double box[4] = {bounds.minLongitude, bounds.minLatitude, bounds.maxLongitude, bounds.maxLatitude};
+    file.append(MAGIC, sizeof(MAGIC));
+    file.append(reinterpret_cast<const char *>(header), sizeof(header));
+    file.append(reinterpret_cast<const char *>(&peakCount), sizeof(peakCount));
+    file.append(reinterpret_cast<const char *>(box), sizeof(box));
+    file.append(reinterpret_cast<const char *>(&prominenceThreshold), sizeof(prominenceThreshold));
+    file.append(reinterpret_cast<const char *>(cellStarts.data()), cellStarts.size() * sizeof(uint64_t));
+    file.append(reinterpret_cast<const char *>(sorted.data()), sorted.size() * sizeof(Record));
+    return file;
+  }
+
+  /**
+   * @brief Grid cell of a point, the extra cell gridSize * gridSize for points without coordinates.
+   */
+  static uint32_t cellOf(const Box &bounds, uint32_t gridSize, double longitude, double latitude)
+  {
+    if (std::isnan(longitude) || std::isnan(latitude))
+      return gridSize * gridSize;
+    return uint32_t(row(bounds, gridSize, latitude)) * gridSize + uint32_t(column(bounds, gridSize, longitude));
+  }
+  static int column(const Box &bounds, uint32_t gridSize, double longitude)
+  {
+    double width = bounds.maxLongitude - bounds.minLongitude;
+    return width > 0 ? std::clamp(int((longitude - bounds.minLongitude) / width * gridSize), 0, int(gridSize) - 1) : 0;
+  }
+  static int row(const Box &bounds, uint32_t gridSize, double latitude)
+  {
+    double height = bounds.maxLatitude - bounds.minLatitude;
+    return height > 0 ? std::clamp(int((latitude - bounds.minLatitude) / height * gridSize), 0, int(gridSize) - 1) : 0;
+  }
+};
+
+/**
+ * @brief Read only, memory mapped view of a .pfi peak index.
+ *
+ * Self contained like PeakColumnsReader, so queries need neither GDAL nor the raster. Throws
+ * std::runtime_error if the file can not be opened or is not a valid index.
+ */
+class PeakIndexReader
+{
+public:
+  explicit PeakIndexReader(const std::string &filename)
+  {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("Unable to open " + filename);
+    struct stat info;
+    if (fstat(fd, &info) != 0 || size_t(info.st_size) < PeakIndex::HEADER_BYTES)
+    {
+      ::close(fd);
+      throw std::runtime_error(filename + " is not a peak index");
+    }
+    fileSize = size_t(info.st_size);
+    void *mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+      throw std::runtime_error("Unable to map " + filename);
+    data = static_cast<const unsigned char *>(mapped);
+
+    try
+    {
+      parse(filename);
+    }
+    catch (...)
+    {
+      munmap(const_cast<unsigned char *>(data), fileSize);
+      throw;
+    }
+  }
+  ~PeakIndexReader()
+  {
+    munmap(const_cast<unsigned char *>(data), fileSize);
+  }
+  PeakIndexReader(const PeakIndexReader &) = delete;
+  PeakIndexReader &operator=(const PeakIndexReader &) = delete;
+
+  size_t peakCount() const
+  {
+    return totalPeaks;
+  }
+  /**
+   * @brief Prominence threshold of the run that wrote the index, NaN for version 1 files that did not record it.
+   */
+  double prominenceThreshold() const
+  {
+    return threshold;
+  }
+
+  /**
+   * @brief Calls visit(record) for every peak with a prominence above threshold inside box, grid cell by grid cell.
+   *
+   * Peaks without coordinates only match a box that covers everywhere.
+   */
+  template <typename Visit>
+  void query(double threshold, const PeakIndex::Box &box, Visit visit) const
+  {
+    auto visitCell = [&](size_t cell, bool checkBox)
+    {
+      for (uint64_t i = cellStarts[cell]; i < cellStarts[cell + 1] && records[i].prominence > threshold; ++i)
+      {
+        if (!checkBox || box.contains(records[i].longitude, records[i].latitude))
+          visit(records[i]);
+      }
+    };
+    if (box.everywhere())
+    {
+      for (size_t cell = 0; cell <= size_t(gridSize) * gridSize; ++cell)
+        visitCell(cell, false);
+      return;
+    }
+    if (box.maxLongitude < bounds.minLongitude || box.minLongitude > bounds.maxLongitude ||
+        box.maxLatitude < bounds.minLatitude || box.minLatitude > bounds.maxLatitude)
+      return;
+    int firstColumn = PeakIndex::column(bounds, gridSize, box.minLongitude);
+    int lastColumn = PeakIndex::column(bounds, gridSize, box.maxLongitude);
+    int firstRow = PeakIndex::row(bounds, gridSize, box.minLatitude);
+    int lastRow = PeakIndex::row(bounds, gridSize, box.maxLatitude);
+    for (int row = firstRow; row <= lastRow; ++row)
+    {
+      for (int column = firstColumn; column <= lastColumn; ++column)
+        visitCell(size_t(row) * gridSize + size_t(column), true);
+    }
+  }
+
+private:
+  const unsigned char *data = nullptr;
+  size_t fileSize = 0;
+  uint32_t gridSize = 0;
+  size_t totalPeaks = 0;
+  double threshold = NAN;
+  PeakIndex::Box bounds;
+  const uint64_t *cellStarts = nullptr;
+  const PeakIndex::Record *records = nullptr;
+
+  template <typename T>
+  T read(size_t offset) const
+  {
+    T value;
+    std::memcpy(&value, data + offset, sizeof(T));
+    return value;
+  }
+
+  void parse(const std::string &filename)
+  {
+    const std::runtime_error invalid(filename + " is not a valid peak index");
+    if (std::memcmp(data, PeakIndex::MAGIC, 8) != 0)
+      throw invalid;
+    uint32_t version = read<uint32_t>(8);
+    if (version != 1 && version != PeakIndex::VERSION)
+      throw std::runtime_error(filename + " has an unsupported peak index version");
+    gridSize = read<uint32_t>(12);
+    totalPeaks = read<uint64_t>(16);
+    bounds = PeakIndex::Box{read<double>(24), read<double>(32), read<double>(40), read<double>(48)};
+    if (version >= 2)
+      threshold = read<double>(56);
+    if (gridSize == 0 || gridSize > PeakIndex::MAX_GRID_SIZE)
+      throw invalid;
+
+    size_t cellCount = size_t(gridSize) * gridSize + 1;
+    size_t recordsOffset = PeakIndex::HEADER_BYTES + (cellCount + 1) * sizeof(uint64_t);
+    if (totalPeaks > fileSize / sizeof(PeakIndex::Record) || fileSize != recordsOffset + totalPeaks * sizeof(PeakIndex::Record))
+      throw invalid;
+    cellStarts = reinterpret_cast<const uint64_t *>(data + PeakIndex::HEADER_BYTES);
+    records = reinterpret_cast<const PeakIndex::Record *>(data + recordsOffset);
+    if (cellStarts[0] != 0 || cellStarts[cellCount] != totalPeaks)
+      throw invalid;
+    for (size_t cell = 0; cell < cellCount; ++cell)
+    {
+      if (cellStarts[cell] > cellStarts[cell + 1])
+        throw invalid;
+    }
+  }
+};
+
+#endif // PEAK_INDEX_H
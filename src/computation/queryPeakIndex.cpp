@@ -0,0 +1,65 @@
+#include "gdal_computation.hpp"
+#include "peakIndex.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Answers a prominence and bounding box query from a peak index, without the raster.
+ *
+ * Gives exactly the peaks a full run with the same threshold would have written, restricted to the box. The
+ * index only holds the peaks above the threshold of the run that wrote it, so a lower threshold is refused with
+ * std::runtime_error instead of answered incompletely. Version 1 indexes did not record their threshold, for
+ * those a warning is printed. Rows are sorted by descending
+ * prominence and have the CSV columns of a run followed by the key col and the parent peak of every peak.
+ *
+ * @param indexFilePath Path of a .pfi index written by a run.
+ * @param outputFilePath Path of the CSV file to write, or empty to print to stdout.
+ * @param prominenceThreshold Only peaks with a higher prominence are written.
+ * @param box Area in degrees the peaks have to lie in.
+ * @return Number of peaks written.
+ */
+size_t queryPeakIndex(const string &indexFilePath, const string &outputFilePath, double prominenceThreshold, const PeakIndex::Box &box)
+{
+  PeakIndexReader index(indexFilePath);
+  if (isnan(index.prominenceThreshold()))
+    cerr << "Warning: " << indexFilePath << " does not record the threshold it was written with, peaks below that threshold are missing" << endl;
+  else if (prominenceThreshold < index.prominenceThreshold())
+  {
+    ostringstream message;
+    message << indexFilePath << " only holds peaks with a prominence above " << index.prominenceThreshold() << ", query it with a threshold of at least that";
+    throw runtime_error(message.str());
+  }
+  vector<const PeakIndex::Record *> matches;
+  index.query(prominenceThreshold, box, [&matches](const PeakIndex::Record &record)
+              { matches.push_back(&record); });
+  sort(matches.begin(), matches.end(), [](const PeakIndex::Record *a, const PeakIndex::Record *b)
+       {
+         if (a->prominence != b->prominence)
+           return a->prominence > b->prominence;
+         return a->y < b->y || (a->y == b->y && a->x < b->x); });
+
+  ofstream file;
+  if (!outputFilePath.empty())
+  {
+    file.open(outputFilePath);
+    if (!file.is_open())
+      throw runtime_error("Unable to open output file: " + outputFilePath);
+  }
+  ostream &out = outputFilePath.empty() ? cout : file;
+  out << "x,y,prominence,latitude,longitude,elevation,col_x,col_y,col_elevation,parent_x,parent_y\n";
+  for (const PeakIndex::Record *record : matches)
+  {
+    out << record->x << ',' << record->y << ',' << record->prominence << ',' << record->latitude << ',' << record->longitude << ','
+        << record->elevation << ',' << record->colX << ',' << record->colY << ',' << record->colElevation << ','
+        << record->parentX << ',' << record->parentY << '\n';
+  }
+  return matches.size();
+}
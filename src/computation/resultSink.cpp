@@ -0,0 +1,324 @@
+#include "resultSink.hpp"
+#include "peakColumns.hpp"
+#include <charconv>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace
+{
+  void appendInteger(string &buffer, int value)
+  {
+    char digits[16];
+    auto end = to_chars(digits, digits + sizeof(digits), value).ptr;
+    buffer.append(digits, end);
+  }
+  // Six significant digits, the same as the default ostream formatting the CSV has always used
+  void appendDecimal(string &buffer, double value)
+  {
+    char digits[32];
+    auto end = to_chars(digits, digits + sizeof(digits), value, chars_format::general, 6).ptr;
+    buffer.append(digits, end);
+  }
+  // Raw column values followed by zeros up to the next multiple of 8 bytes
+  template <typename T>
+  void appendColumn(string &buffer, const vector<T> &values)
+  {
+    buffer.append(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+    buffer.append(PeakColumns::columnBytes(values.size(), sizeof(T)) - values.size() * sizeof(T), '\0');
+  }
+  bool endsWith(const string &text, const string &suffix)
+  {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+  }
+}
+
+ResultSink::ResultSink(const string &filename, double prominenceThreshold, unique_ptr<Transformer> transformer, bool backgroundWriter, bool sourceFileColumn)
+    : transformer(std::move(transformer)), sourceFileColumn(sourceFileColumn), prominenceThreshold(prominenceThreshold)
+{
+  if (filename.empty())
+    return;
+  if (sourceFileColumn && (endsWith(filename, ".pfc") || endsWith(filename, ".pfi")))
+    throw invalid_argument("Peaks of several datasets can only be written to CSV, which says which file every peak is from.");
+  file.open(filename, ios::binary | ios::trunc);
+  if (!file.is_open())
+  {
+    cerr << "Error: Unable to open file for writing.\n";
+    return;
+  }
+  accepting = true;
+
+  batch.reserve(BATCH_SIZE);
+  buffer.reserve(BUFFER_SIZE + BATCH_SIZE * 128);
+  columnar = endsWith(filename, ".pfc");
+  indexed = endsWith(filename, ".pfi");
+  if (columnar)
+  {
+    uint32_t header[2] = {PeakColumns::VERSION, PeakColumns::ROW_GROUP_SIZE};
+    buffer.append(PeakColumns::MAGIC, sizeof(PeakColumns::MAGIC));
+    buffer.append(reinterpret_cast<const char *>(header), sizeof(header));
+  }
+  else if (!indexed) // The index is laid out in one go by close()
+  {
+    buffer += CSV_COLUMNS;
+    buffer += sourceFileColumn ? ",file\n" : "\n";
+  }
+  if (backgroundWriter && thread::hardware_concurrency() > 1)
+  {
+    pending.reserve(BATCH_SIZE);
+    writer = thread(&ResultSink::writerLoop, this);
+  }
+}
+
+ResultSink::~ResultSink()
+{
+  close();
+}
+
+void ResultSink::write(const PeakResult &peak)
+{
+  ++peaksSeen;
+  if (!accepting)
+    return;
+  batch.push_back(peak);
+  if (batch.size() == BATCH_SIZE)
+    submitBatch();
+}
+
+void ResultSink::setSource(unique_ptr<Transformer> newTransformer, const string &sourceFile)
+{
+  // Every batch is encoded with a single source, so the peaks collected so far go out with the old one
+  submitBatch();
+  if (writer.joinable())
+  {
+    unique_lock<mutex> lock(writerMutex);
+    writerWake.wait(lock, [this]
+                    { return pending.empty(); });
+  }
+  transformer = std::move(newTransformer);
+  // Quoted if it would otherwise split the row
+  if (sourceFile.find_first_of(",\"\r\n") == string::npos)
+    sourceField = sourceFile;
+  else
+  {
+    sourceField = "\"";
+    for (char c : sourceFile)
+      sourceField += c == '"' ? string("\"\"") : string(1, c);
+    sourceField += '"';
+  }
+}
+
+void ResultSink::close()
+{
+  if (!accepting)
+    return;
+  accepting = false;
+  submitBatch();
+  if (writer.joinable())
+  {
+    {
+      lock_guard<mutex> lock(writerMutex);
+      stopping = true;
+    }
+    writerWake.notify_all();
+    writer.join();
+  }
+  if (columnar)
+  {
+    appendRowGroup();
+    appendFooter();
+  }
+  if (indexed)
+  {
+    buffer += PeakIndex::encode(std::move(indexRecords), prominenceThreshold);
+    indexRecords = {};
+  }
+  flushBuffer();
+  file.close();
+  if (file.fail())
+    cerr << "Error: Failed to write the output file.\n";
+}
+
+/**
+ * @brief Hands the collected batch over to be encoded, to the writer thread if there is one.
+ *
+ * With a writer thread the two batches are swapped, so the caller keeps collecting while the previous batch
+ * is encoded. Waits only if the writer has not finished the batch before that yet.
+ */
+void ResultSink::submitBatch()
+{
+  if (batch.empty())
+    return;
+  if (!writer.joinable())
+  {
+    encodeBatch(batch);
+    batch.clear();
+    return;
+  }
+  unique_lock<mutex> lock(writerMutex);
+  writerWake.wait(lock, [this]
+                  { return pending.empty(); });
+  swap(batch, pending);
+  lock.unlock();
+  writerWake.notify_all();
+}
+
+void ResultSink::writerLoop()
+{
+  unique_lock<mutex> lock(writerMutex);
+  while (true)
+  {
+    writerWake.wait(lock, [this]
+                    { return stopping || !pending.empty(); });
+    if (pending.empty())
+      return; // Stopping, and everything has been encoded
+    lock.unlock();
+    encodeBatch(pending);
+    lock.lock();
+    pending.clear();
+    writerWake.notify_all();
+  }
+}
+
+/**
+ * @brief Transforms the coordinates of a batch in one go and appends its rows to the buffer.
+ */
+void ResultSink::encodeBatch(const vector<PeakResult> &peaks)
+{
+  size_t count = peaks.size();
+  batchLatitudes.assign(count, NAN);
+  batchLongitudes.assign(count, NAN);
+  if (transformer)
+  {
+    pixelXs.resize(count);
+    pixelYs.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      pixelXs[i] = peaks[i].peakCoords.x;
+      pixelYs[i] = peaks[i].peakCoords.y;
+    }
+    transformer->transform(count, pixelXs.data(), pixelYs.data(), batchLatitudes.data(), batchLongitudes.data());
+  }
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (indexed)
+      appendIndexRecord(peaks[i], batchLatitudes[i], batchLongitudes[i]);
+    else if (columnar)
+      appendColumnarRow(peaks[i], batchLatitudes[i], batchLongitudes[i]);
+    else
+      appendCsvRow(peaks[i], batchLatitudes[i], batchLongitudes[i]);
+  }
+  if (buffer.size() >= BUFFER_SIZE)
+    flushBuffer();
+}
+
+void ResultSink::appendCsvRow(const PeakResult &peak, double latitude, double longitude)
+{
+  appendCsvFields(buffer, peak, latitude, longitude);
+  if (sourceFileColumn)
+  {
+    buffer += ',';
+    buffer += sourceField;
+  }
+  buffer += '\n';
+}
+
+void ResultSink::appendCsvDecimal(string &buffer, double value)
+{
+  appendDecimal(buffer, value);
+}
+
+void ResultSink::appendCsvFields(string &buffer, const PeakResult &peak, double latitude, double longitude)
+{
+  appendInteger(buffer, peak.peakCoords.x);
+  buffer += ',';
+  appendInteger(buffer, peak.peakCoords.y);
+  buffer += ',';
+  appendDecimal(buffer, peak.prominence);
+  buffer += ',';
+  // NaN without a transformer, every row keeps the columns of the header
+  appendDecimal(buffer, latitude);
+  buffer += ',';
+  appendDecimal(buffer, longitude);
+  buffer += ',';
+  appendDecimal(buffer, peak.elevation);
+  buffer += ',';
+  appendInteger(buffer, peak.colCoords.x);
+  buffer += ',';
+  appendInteger(buffer, peak.colCoords.y);
+  buffer += ',';
+  appendDecimal(buffer, peak.colElevation);
+  buffer += ',';
+  appendInteger(buffer, peak.parentCoords.x);
+  buffer += ',';
+  appendInteger(buffer, peak.parentCoords.y);
+}
+
+void ResultSink::appendColumnarRow(const PeakResult &peak, double latitude, double longitude)
+{
+  xs.push_back(peak.peakCoords.x);
+  ys.push_back(peak.peakCoords.y);
+  elevations.push_back(peak.elevation);
+  prominences.push_back(peak.prominence);
+  latitudes.push_back(latitude);
+  longitudes.push_back(longitude);
+  colXs.push_back(peak.colCoords.x);
+  colYs.push_back(peak.colCoords.y);
+  colElevations.push_back(peak.colElevation);
+  parentXs.push_back(peak.parentCoords.x);
+  parentYs.push_back(peak.parentCoords.y);
+  if (xs.size() == PeakColumns::ROW_GROUP_SIZE)
+    appendRowGroup();
+}
+
+void ResultSink::appendIndexRecord(const PeakResult &peak, double latitude, double longitude)
+{
+  indexRecords.push_back({peak.prominence, peak.elevation, latitude, longitude, peak.colElevation, peak.peakCoords.x, peak.peakCoords.y,
+                          peak.colCoords.x, peak.colCoords.y, peak.parentCoords.x, peak.parentCoords.y});
+}
+
+/**
+ * @brief Moves the collected rows into the buffer as one row group.
+ */
+void ResultSink::appendRowGroup()
+{
+  if (xs.empty())
+    return;
+  rowGroupOffsets.push_back(bytesWritten + buffer.size());
+  uint32_t header[2] = {uint32_t(xs.size()), 0};
+  buffer.append(reinterpret_cast<const char *>(header), sizeof(header));
+  appendColumn(buffer, xs);
+  appendColumn(buffer, ys);
+  appendColumn(buffer, elevations);
+  appendColumn(buffer, prominences);
+  appendColumn(buffer, latitudes);
+  appendColumn(buffer, longitudes);
+  appendColumn(buffer, colXs);
+  appendColumn(buffer, colYs);
+  appendColumn(buffer, colElevations);
+  appendColumn(buffer, parentXs);
+  appendColumn(buffer, parentYs);
+  rowCount += xs.size();
+  for (auto *column : {&xs, &ys, &colXs, &colYs, &parentXs, &parentYs})
+    column->clear();
+  for (auto *column : {&elevations, &prominences, &latitudes, &longitudes, &colElevations})
+    column->clear();
+}
+
+void ResultSink::appendFooter()
+{
+  uint64_t counts[2] = {rowGroupOffsets.size(), rowCount};
+  buffer.append(reinterpret_cast<const char *>(rowGroupOffsets.data()), rowGroupOffsets.size() * sizeof(uint64_t));
+  buffer.append(reinterpret_cast<const char *>(counts), sizeof(counts));
+  buffer.append(PeakColumns::MAGIC, sizeof(PeakColumns::MAGIC));
+}
+
+void ResultSink::flushBuffer()
+{
+  file.write(buffer.data(), streamsize(buffer.size()));
+  bytesWritten += buffer.size();
+  buffer.clear();
+}
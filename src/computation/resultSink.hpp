@@ -0,0 +1,137 @@
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gdal_computation.hpp"
+#include "peakIndex.hpp"
+
+#ifndef RESULT_SINK_H
+#define RESULT_SINK_H
+
+/**
+ * @brief Long lived writer for the peak output file.
+ *
+ * Writes CSV, the binary columnar format described in peakColumns.hpp if the file name ends in .pfc, or the
+ * peak index described in peakIndex.hpp if it ends in .pfi. The index is sorted, so it is only written on close().
+ * The file is opened once and the header written when the sink is created. Peaks are collected into
+ * batches; the coordinates of a whole batch are transformed at once and its rows are then formatted with
+ * std::to_chars into a large buffer, which is handed to the file in big writes. With a background writer,
+ * transforming, formatting and writing all happen on that thread while the next batch fills up, and the
+ * transformer is only ever used from there. The file is flushed and closed exactly once, by close() or the
+ * destructor.
+ *
+ * Output that collects the peaks of several datasets ends every CSV row with the file the peak was found in,
+ * as its pixel coordinates mean nothing without it. The binary formats have no such column.
+ *
+ * A sink created with an empty file name discards all rows, so engines can write unconditionally.
+ * Not thread safe, callers writing from several threads have to serialize their calls.
+ */
+class ResultSink
+{
+public:
+  /**
+   * @param filename Path of the file to create, or empty to discard all rows.
+   * @param prominenceThreshold Threshold the peaks are written above, recorded in a peak index.
+   * @param transformer Used to add latitude and longitude to every row, may be null. Owned by the sink.
+   * @param backgroundWriter If true, batches are transformed, formatted and written by a separate thread.
+   * @param sourceFileColumn If true, the CSV gets a file column, see setSource. Throws std::invalid_argument
+   * for the binary formats.
+   */
+  ResultSink(const std::string &filename, double prominenceThreshold, std::unique_ptr<Transformer> transformer = nullptr, bool backgroundWriter = true, bool sourceFileColumn = false);
+  ~ResultSink();
+  ResultSink(const ResultSink &) = delete;
+  ResultSink &operator=(const ResultSink &) = delete;
+
+  /**
+   * @brief Appends one peak to the output.
+   */
+  void write(const PeakResult &peak);
+
+  /**
+   * @brief Uses transformer for the peaks written from now on and names sourceFile in their file column, for
+   * output that collects the peaks of several datasets.
+   */
+  void setSource(std::unique_ptr<Transformer> transformer, const std::string &sourceFile);
+
+  /**
+   * @brief Writes out everything still buffered and closes the file. Later writes are ignored.
+   */
+  void close();
+
+  /**
+   * @brief Column names of a peak in CSV output, in the order appendCsvFields writes them.
+   */
+  static constexpr const char *CSV_COLUMNS = "x,y,prominence,latitude,longitude,elevation,col_x,col_y,col_elevation,parent_x,parent_y";
+
+  /**
+   * @brief Appends the CSV fields of a peak to buffer, separated by commas and without a line break.
+   *
+   * Shared with the other CSV writers, so every output formats peaks the same way.
+   */
+  static void appendCsvFields(std::string &buffer, const PeakResult &peak, double latitude, double longitude);
+
+  /**
+   * @brief Appends value with six significant digits, like every decimal of the CSV output.
+   */
+  static void appendCsvDecimal(std::string &buffer, double value);
+
+  /**
+   * @brief Number of peaks passed to write() so far, whether the sink kept them or not.
+   */
+  uint64_t peakCount() const
+  {
+    return peaksSeen;
+  }
+
+private:
+  static constexpr size_t BATCH_SIZE = 4096;     // Peaks transformed and formatted together
+  static constexpr size_t BUFFER_SIZE = 1 << 20; // Encoded bytes are handed to the file once they reach this size
+
+  bool accepting = false;        // Open and not closed yet
+  uint64_t peaksSeen = 0;
+  std::vector<PeakResult> batch; // Filled by write()
+
+  // Only touched by the thread encoding batches: the background writer if there is one, the caller otherwise
+  std::ofstream file;
+  std::unique_ptr<Transformer> transformer;
+  bool sourceFileColumn = false;
+  std::string sourceField; // File column of the current source, quoted for CSV
+  std::vector<int> pixelXs, pixelYs;
+  std::vector<double> batchLatitudes, batchLongitudes;
+  std::string buffer;
+  uint64_t bytesWritten = 0;
+
+  // Row group being filled and the file offsets of the finished ones, for the columnar format
+  bool columnar = false;
+  std::vector<int32_t> xs, ys, colXs, colYs, parentXs, parentYs;
+  std::vector<double> elevations, prominences, latitudes, longitudes, colElevations;
+  std::vector<uint64_t> rowGroupOffsets;
+  uint64_t rowCount = 0;
+
+  // Every peak of the index, which can only be laid out once all of them are known
+  bool indexed = false;
+  double prominenceThreshold;
+  std::vector<PeakIndex::Record> indexRecords;
+
+  // Background writer, pending holds the batch it is encoding or is about to encode
+  std::thread writer;
+  std::mutex writerMutex;
+  std::condition_variable writerWake;
+  std::vector<PeakResult> pending;
+  bool stopping = false;
+
+  void submitBatch();
+  void encodeBatch(const std::vector<PeakResult> &peaks);
+  void appendCsvRow(const PeakResult &peak, double latitude, double longitude);
+  void appendColumnarRow(const PeakResult &peak, double latitude, double longitude);
+  void appendIndexRecord(const PeakResult &peak, double latitude, double longitude);
+  void appendRowGroup();
+  void appendFooter();
+  void flushBuffer();
+  void writerLoop();
+};
+
+#endif // RESULT_SINK_H
@@ -0,0 +1,214 @@
+#include "gdal_computation.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Layout of a tile state file, all values little endian:
+ *
+ *     header  "PEAKTILE", uint32 version, int32 dataset width, dataset height, tile width, tile height,
+ *             prominence threshold, uint64 tile count
+ *     tiles   per tile uint64 resolved, pending and boundary node counts, then the resolved peaks, the pending
+ *             peaks each followed by uint32 node, and the boundary nodes as uint64 cell, f32 elevation,
+ *             uint32 parent, uint8 on tile edge
+ *
+ * A peak is int32 x, y, col x, col y, parent x, parent y, then f64 elevation, prominence and col elevation.
+ */
+namespace
+{
+  constexpr char MAGIC[8] = {'P', 'E', 'A', 'K', 'T', 'I', 'L', 'E'};
+  constexpr uint32_t VERSION = 1;
+
+  class StateWriter
+  {
+  public:
+    explicit StateWriter(ofstream &file) : file(file) {}
+    ~StateWriter()
+    {
+      flush();
+    }
+
+    template <typename T>
+    void put(const T &value)
+    {
+      buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+      if (buffer.size() >= (1 << 20))
+        flush();
+    }
+    void putPeak(const PeakResult &peak)
+    {
+      for (int value : {peak.peakCoords.x, peak.peakCoords.y, peak.colCoords.x, peak.colCoords.y, peak.parentCoords.x, peak.parentCoords.y})
+        put(int32_t(value));
+      put(peak.elevation);
+      put(peak.prominence);
+      put(peak.colElevation);
+    }
+    void flush()
+    {
+      file.write(buffer.data(), streamsize(buffer.size()));
+      buffer.clear();
+    }
+
+  private:
+    ofstream &file;
+    string buffer;
+  };
+
+  class StateReader
+  {
+  public:
+    StateReader(ifstream &file, const string &filename) : file(file), filename(filename) {}
+
+    template <typename T>
+    T get()
+    {
+      T value;
+      if (!file.read(reinterpret_cast<char *>(&value), sizeof(T)))
+        throw runtime_error(filename + " is truncated");
+      return value;
+    }
+    PeakResult getPeak()
+    {
+      int32_t coords[6];
+      for (int32_t &value : coords)
+        value = get<int32_t>();
+      double elevation = get<double>();
+      double prominence = get<double>();
+      double colElevation = get<double>();
+      return PeakResult(Coords(coords[0], coords[1]), elevation, prominence, Coords(coords[2], coords[3]), colElevation, Coords(coords[4], coords[5]));
+    }
+    // Element count that is checked against the bytes left in the file before anything is allocated for it
+    size_t getCount(size_t minimumBytesEach)
+    {
+      uint64_t count = get<uint64_t>();
+      if (count > remaining() / minimumBytesEach)
+        throw runtime_error(filename + " is not a valid tile state");
+      return size_t(count);
+    }
+
+  private:
+    ifstream &file;
+    const string &filename;
+
+    uint64_t remaining()
+    {
+      auto position = file.tellg();
+      file.seekg(0, ios::end);
+      auto end = file.tellg();
+      file.seekg(position);
+      return uint64_t(end - position);
+    }
+  };
+}
+
+/**
+ * @brief Saves the layout and the results of every tile of a tiled run.
+ *
+ * Written to a temporary file next to filename that then replaces it, so an update that reads and writes
+ * the same state never leaves it half written.
+ */
+void writeTileState(const string &filename, const TileState &state)
+{
+  string temporaryName = filename + ".tmp";
+  {
+    ofstream file(temporaryName, ios::binary | ios::trunc);
+    if (!file.is_open())
+      throw runtime_error("Unable to open " + temporaryName + " for writing");
+    StateWriter writer(file);
+    file.write(MAGIC, sizeof(MAGIC));
+    writer.put(VERSION);
+    for (int value : {state.datasetWidth, state.datasetHeight, state.tileWidth, state.tileHeight, state.prominenceThreshold})
+      writer.put(int32_t(value));
+    writer.put(uint64_t(state.tiles.size()));
+    for (const TileResult &tile : state.tiles)
+    {
+      writer.put(uint64_t(tile.resolvedPeaks.size()));
+      writer.put(uint64_t(tile.pendingPeaks.size()));
+      writer.put(uint64_t(tile.boundaryTree.size()));
+      for (const PeakResult &peak : tile.resolvedPeaks)
+        writer.putPeak(peak);
+      for (const auto &pending : tile.pendingPeaks)
+      {
+        writer.putPeak(pending.peak);
+        writer.put(pending.node);
+      }
+      for (const BoundaryNode &node : tile.boundaryTree)
+      {
+        writer.put(node.cell);
+        writer.put(node.elevation);
+        writer.put(node.parent);
+        writer.put(uint8_t(node.onTileEdge));
+      }
+    }
+    writer.flush();
+    if (!file)
+      throw runtime_error("Failed to write " + temporaryName);
+  }
+  if (rename(temporaryName.c_str(), filename.c_str()) != 0)
+    throw runtime_error("Unable to replace " + filename);
+}
+
+/**
+ * @brief Reads a state saved by writeTileState. Throws std::runtime_error if it is not a valid tile state.
+ */
+TileState readTileState(const string &filename)
+{
+  ifstream file(filename, ios::binary);
+  if (!file.is_open())
+    throw runtime_error("Unable to open " + filename);
+  StateReader reader(file, filename);
+
+  char magic[sizeof(MAGIC)];
+  if (!file.read(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+    throw runtime_error(filename + " is not a tile state");
+  if (reader.get<uint32_t>() != VERSION)
+    throw runtime_error(filename + " has an unsupported tile state version");
+
+  TileState state;
+  state.datasetWidth = reader.get<int32_t>();
+  state.datasetHeight = reader.get<int32_t>();
+  state.tileWidth = reader.get<int32_t>();
+  state.tileHeight = reader.get<int32_t>();
+  state.prominenceThreshold = reader.get<int32_t>();
+  if (state.datasetWidth <= 0 || state.datasetHeight <= 0 || state.tileWidth <= 0 || state.tileHeight <= 0)
+    throw runtime_error(filename + " is not a valid tile state");
+  size_t tilesX = (size_t(state.datasetWidth) + state.tileWidth - 1) / state.tileWidth;
+  size_t tilesY = (size_t(state.datasetHeight) + state.tileHeight - 1) / state.tileHeight;
+  if (reader.get<uint64_t>() != tilesX * tilesY)
+    throw runtime_error(filename + " is not a valid tile state");
+
+  state.tiles.resize(tilesX * tilesY);
+  for (TileResult &tile : state.tiles)
+  {
+    size_t resolvedCount = reader.getCount(48);
+    size_t pendingCount = reader.getCount(52);
+    size_t nodeCount = reader.getCount(17);
+    tile.resolvedPeaks.reserve(resolvedCount);
+    for (size_t i = 0; i < resolvedCount; ++i)
+      tile.resolvedPeaks.push_back(reader.getPeak());
+    tile.pendingPeaks.reserve(pendingCount);
+    for (size_t i = 0; i < pendingCount; ++i)
+    {
+      PeakResult peak = reader.getPeak();
+      uint32_t node = reader.get<uint32_t>();
+      if (node >= nodeCount)
+        throw runtime_error(filename + " is not a valid tile state");
+      tile.pendingPeaks.push_back({peak, node});
+    }
+    tile.boundaryTree.resize(nodeCount);
+    for (BoundaryNode &node : tile.boundaryTree)
+    {
+      node.cell = reader.get<uint64_t>();
+      node.elevation = reader.get<float>();
+      node.parent = reader.get<uint32_t>();
+      node.onTileEdge = reader.get<uint8_t>() != 0;
+      if (node.parent != PeakForest::NONE && node.parent >= nodeCount)
+        throw runtime_error(filename + " is not a valid tile state");
+    }
+  }
+  return state;
+}
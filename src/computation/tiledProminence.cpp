@@ -0,0 +1,556 @@
+#include "gdal_computation.hpp"
+#include "resultSink.hpp"
+#include "../prominence/runStats.hpp"
+#include <iostream>
+#include <memory>
+#include <gdal.h>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <gdal_priv.h>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+using namespace std;
+
+// Bytes held per padded tile cell while a tile is swept: elevation and island id in the grid,
+// parent, peak and size in the PeakForest, the boundary tree anchor and the sweep order.
+constexpr size_t TILE_BYTES_PER_CELL = 28;
+
+/**
+ * @brief Sweeps a single tile with the union-find engine and reduces it to what other tiles can influence.
+ *
+ * Cells are added from the highest to the lowest like in calculateProminenceUnionFind. A component whose
+ * cells never reach the edge shared with another tile lies entirely inside the tile, so when it merges with
+ * a higher component its peak's prominence is final. Once a component reaches such an edge it is "anchored":
+ * its peak, its edge cells and every saddle where two anchored components join are kept as BoundaryNodes,
+ * each pointing to the lower node it joined. Restricted to any water level, that tree connects the kept
+ * nodes exactly like the tile's own cells do, which is all the stitching step needs.
+ *
+ * @param tile The tile loaded by loadRasterWindow.
+ * @param xOffset Column of the dataset where the tile starts.
+ * @param yOffset Row of the dataset where the tile starts.
+ * @param datasetWidth Width of the whole dataset.
+ * @param datasetHeight Height of the whole dataset.
+ * @param prominenceThreshold Minimum prominence value for resolved peaks to be kept.
+ * @param scratch Working arrays, overwritten.
+ * @return The resolved peaks, the ones still missing their parent and the reduced merge tree of the tile.
+ */
+TileResult processTile(const ElevationGrid &tile, int xOffset, int yOffset, int datasetWidth, int datasetHeight, int prominenceThreshold, TileScratch &scratch)
+{
+  TileResult result;
+  const float *elevations = tile.elevations();
+  const auto neighborOffsets = tile.neighborOffsets();
+  bool hasLeftTile = xOffset > 0;
+  bool hasRightTile = xOffset + tile.width < datasetWidth;
+  bool hasTopTile = yOffset > 0;
+  bool hasBottomTile = yOffset + tile.height < datasetHeight;
+
+  // Global sweep order is elevation first and dataset index second, which within a tile is the padded index order
+  vector<uint32_t> &order = scratch.order;
+  order.clear();
+  order.reserve(size_t(tile.width) * tile.height);
+  for (int y = 0; y < tile.height; ++y)
+  {
+    for (int x = 0; x < tile.width; ++x)
+    {
+      uint32_t cell = tile.index(x, y);
+      if (elevations[cell] == -INFINITY)
+        continue;
+      order.push_back(cell);
+    }
+  }
+  auto isHigher = [&elevations](uint32_t a, uint32_t b)
+  {
+    return elevations[a] > elevations[b] || (elevations[a] == elevations[b] && a < b);
+  };
+  sort(order.begin(), order.end(), isHigher);
+
+  auto keepNode = [&](uint32_t cell, bool onTileEdge)
+  {
+    Coords coords = tile.coords(cell);
+    uint64_t datasetCell = uint64_t(yOffset + coords.y) * datasetWidth + uint64_t(xOffset + coords.x);
+    result.boundaryTree.push_back({datasetCell, elevations[cell], PeakForest::NONE, onTileEdge});
+    return uint32_t(result.boundaryTree.size() - 1);
+  };
+  auto datasetCoords = [&](uint32_t cell)
+  {
+    Coords coords = tile.coords(cell);
+    return Coords(xOffset + coords.x, yOffset + coords.y);
+  };
+  auto peakResult = [&](uint32_t peakCell, uint32_t colCell)
+  {
+    double colElevation = colCell == PeakForest::NONE ? NAN : elevations[colCell];
+    double prominence = colCell == PeakForest::NONE ? elevations[peakCell] : double(elevations[peakCell]) - colElevation;
+    return PeakResult(datasetCoords(peakCell), elevations[peakCell], prominence,
+                      colCell == PeakForest::NONE ? Coords(-1, -1) : datasetCoords(colCell), colElevation);
+  };
+
+  PeakForest &forest = scratch.forest;
+  forest.reset(tile.size());
+  // The lowest kept node of every anchored component, indexed by the component's root
+  vector<uint32_t> &anchor = scratch.anchor;
+  anchor.assign(tile.size(), PeakForest::NONE);
+
+  // Peaks that reached their key col at the elevation being swept, with the root they merged into. Their parent is
+  // the highest peak of that component once every cell of this elevation is in. If the component has reached
+  // another tile by then, that peak may lie outside and the stitching step has to find it
+  vector<pair<PeakResult, uint32_t>> levelPeaks;
+  float levelElevation = INFINITY;
+  auto finishLevel = [&]()
+  {
+    for (auto &[peak, root] : levelPeaks)
+    {
+      uint32_t mergedRoot = forest.find(root);
+      if (anchor[mergedRoot] == PeakForest::NONE)
+      {
+        peak.parentCoords = datasetCoords(forest.peakOf(mergedRoot));
+        result.resolvedPeaks.push_back(peak);
+      }
+      else
+        result.pendingPeaks.push_back({peak, anchor[mergedRoot]});
+    }
+    levelPeaks.clear();
+  };
+
+  for (uint32_t cell : order)
+  {
+    if (elevations[cell] != levelElevation)
+    {
+      finishLevel();
+      levelElevation = elevations[cell];
+    }
+    Coords coords = tile.coords(cell);
+    bool onTileEdge = (hasLeftTile && coords.x == 0) || (hasRightTile && coords.x == tile.width - 1) ||
+                      (hasTopTile && coords.y == 0) || (hasBottomTile && coords.y == tile.height - 1);
+
+    uint32_t roots[8];
+    int rootCount = 0;
+    bool anchored = onTileEdge;
+    for (ptrdiff_t offset : neighborOffsets)
+    {
+      uint32_t neighbor = uint32_t(cell + offset);
+      if (!forest.contains(neighbor))
+        continue;
+      uint32_t root = forest.find(neighbor);
+      if (find(roots, roots + rootCount, root) == roots + rootCount)
+      {
+        roots[rootCount++] = root;
+        anchored = anchored || anchor[root] != PeakForest::NONE;
+      }
+    }
+
+    forest.makeSet(cell);
+    if (rootCount == 0)
+    {
+      // A new peak, kept right away if it sits on the tile edge
+      if (onTileEdge)
+        anchor[cell] = keepNode(cell, true);
+      continue;
+    }
+
+    // If the merged component reaches another tile its highest peak has to be kept as well
+    uint32_t winner = forest.highestRoot(roots, rootCount, isHigher);
+    if (anchored && anchor[winner] == PeakForest::NONE)
+      anchor[winner] = keepNode(forest.peakOf(winner), false);
+
+    uint32_t children[8];
+    int childCount = 0;
+    for (int i = 0; i < rootCount; ++i)
+    {
+      if (anchor[roots[i]] != PeakForest::NONE)
+        children[childCount++] = anchor[roots[i]];
+    }
+
+    uint32_t mergedRoot = forest.mergeAtCol(cell, roots, rootCount, isHigher, [&](uint32_t lowerRoot, uint32_t winnerRoot)
+                                            {
+                                              // Never reached another tile, so nothing outside can give it a higher col
+                                              if (anchor[lowerRoot] == PeakForest::NONE)
+                                              {
+                                                PeakResult peak = peakResult(forest.peakOf(lowerRoot), cell);
+                                                if (peak.prominence > prominenceThreshold)
+                                                  levelPeaks.emplace_back(peak, winnerRoot);
+                                              }
+                                            });
+
+    uint32_t mergedAnchor = childCount == 1 ? children[0] : PeakForest::NONE;
+    if (onTileEdge || childCount >= 2)
+    {
+      mergedAnchor = keepNode(cell, onTileEdge);
+      for (int i = 0; i < childCount; ++i)
+        result.boundaryTree[children[i]].parent = mergedAnchor;
+    }
+    anchor[mergedRoot] = mergedAnchor;
+  }
+  finishLevel();
+
+  // Components that are cut off from every other tile keep their full elevation as prominence
+  for (uint32_t cell : order)
+  {
+    if (forest.find(cell) == cell && anchor[cell] == PeakForest::NONE)
+    {
+      PeakResult peak = peakResult(forest.peakOf(cell), PeakForest::NONE);
+      if (peak.prominence > prominenceThreshold)
+        result.resolvedPeaks.push_back(peak);
+    }
+  }
+  return result;
+}
+
+/**
+ * @brief Combines the reduced merge trees of all tiles into the prominence of the unresolved peaks.
+ *
+ * Builds a graph out of the BoundaryNodes of every tile, joined by the edges of each tile's merge tree and
+ * by the grid adjacency between edge cells of neighbouring tiles, and sweeps it with the same union-find
+ * rules as a single tile. Since every tile's tree preserves how its kept nodes connect at every water
+ * level, the result is exactly what an in-memory sweep over the whole dataset would give.
+ *
+ * @param tiles The results of processTile for every tile.
+ * @param datasetWidth Width of the whole dataset.
+ * @param datasetHeight Height of the whole dataset.
+ * @param tileWidth Width of a tile, the last column of tiles may be narrower.
+ * @param tileHeight Height of a tile, the last row of tiles may be lower.
+ * @param prominenceThreshold Minimum prominence value for peaks to be included in the output.
+ * @return The peaks that could not be resolved inside a single tile, and the pending peaks of every tile with their parents.
+ */
+vector<PeakResult> stitchTiles(const vector<TileResult> &tiles, int datasetWidth, int datasetHeight, int tileWidth, int tileHeight, int prominenceThreshold)
+{
+  size_t nodeCount = 0;
+  for (const auto &tile : tiles)
+    nodeCount += tile.boundaryTree.size();
+  if (nodeCount >= PeakForest::NONE)
+  {
+    throw runtime_error("Too many tile boundary cells to stitch, use a larger tile size.");
+  }
+
+  // Peaks waiting for the sweep to pass below their key col: the pending peaks of the tiles, sorted by col
+  // elevation, and the peaks that reach their key col in the stitched graph. Their parent is the highest peak of
+  // the component node is in, once every node at the elevation of the col is in
+  struct ParentQuery
+  {
+    float colElevation;
+    uint32_t node;
+    PeakResult peak;
+  };
+  vector<ParentQuery> tileQueries;
+  vector<ParentQuery> levelQueries;
+
+  vector<uint64_t> cells;
+  vector<float> elevations;
+  vector<pair<uint32_t, uint32_t>> edges;
+  vector<pair<uint64_t, uint32_t>> edgeCells; // Cells on a tile edge, sorted by dataset index for lookups
+  cells.reserve(nodeCount);
+  elevations.reserve(nodeCount);
+  for (const auto &tile : tiles)
+  {
+    uint32_t base = uint32_t(cells.size());
+    for (const auto &pending : tile.pendingPeaks)
+      tileQueries.push_back({float(pending.peak.colElevation), base + pending.node, pending.peak});
+    for (const auto &node : tile.boundaryTree)
+    {
+      uint32_t id = uint32_t(cells.size());
+      cells.push_back(node.cell);
+      elevations.push_back(node.elevation);
+      if (node.parent != PeakForest::NONE)
+        edges.emplace_back(id, base + node.parent);
+      if (node.onTileEdge)
+        edgeCells.emplace_back(node.cell, id);
+    }
+  }
+  sort(edgeCells.begin(), edgeCells.end());
+
+  // Connect edge cells to their neighbours on the other side of the tile edge
+  for (const auto &[cell, id] : edgeCells)
+  {
+    int x = int(cell % datasetWidth);
+    int y = int(cell / datasetWidth);
+    for (int ny = y - 1; ny <= y + 1; ++ny)
+    {
+      for (int nx = x - 1; nx <= x + 1; ++nx)
+      {
+        if (nx < 0 || ny < 0 || nx >= datasetWidth || ny >= datasetHeight)
+          continue;
+        uint64_t neighborCell = uint64_t(ny) * datasetWidth + nx;
+        bool sameTile = nx / tileWidth == x / tileWidth && ny / tileHeight == y / tileHeight;
+        // Every cross tile pair is added once, from its lower index
+        if (sameTile || neighborCell < cell)
+          continue;
+        auto it = lower_bound(edgeCells.begin(), edgeCells.end(), make_pair(neighborCell, uint32_t(0)));
+        if (it != edgeCells.end() && it->first == neighborCell)
+          edges.emplace_back(id, it->second);
+      }
+    }
+  }
+
+  // Compressed adjacency lists
+  vector<uint32_t> adjacencyStart(nodeCount + 1, 0);
+  for (const auto &[a, b] : edges)
+  {
+    adjacencyStart[a + 1]++;
+    adjacencyStart[b + 1]++;
+  }
+  for (size_t i = 0; i < nodeCount; ++i)
+    adjacencyStart[i + 1] += adjacencyStart[i];
+  vector<uint32_t> adjacency(adjacencyStart.back());
+  vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+  for (const auto &[a, b] : edges)
+  {
+    adjacency[fill[a]++] = b;
+    adjacency[fill[b]++] = a;
+  }
+  edges.clear();
+  edges.shrink_to_fit();
+
+  vector<uint32_t> order(nodeCount);
+  for (uint32_t i = 0; i < nodeCount; ++i)
+    order[i] = i;
+  auto isHigher = [&](uint32_t a, uint32_t b)
+  {
+    return elevations[a] > elevations[b] || (elevations[a] == elevations[b] && cells[a] < cells[b]);
+  };
+  sort(order.begin(), order.end(), isHigher);
+  stable_sort(tileQueries.begin(), tileQueries.end(), [](const ParentQuery &a, const ParentQuery &b)
+              { return a.colElevation > b.colElevation; });
+
+  vector<PeakResult> results;
+  auto nodeCoords = [&](uint32_t node)
+  {
+    return Coords(int(cells[node] % datasetWidth), int(cells[node] / datasetWidth));
+  };
+  auto peakResult = [&](uint32_t peakNode, uint32_t colNode)
+  {
+    double colElevation = colNode == PeakForest::NONE ? NAN : elevations[colNode];
+    double prominence = colNode == PeakForest::NONE ? elevations[peakNode] : double(elevations[peakNode]) - colElevation;
+    return PeakResult(nodeCoords(peakNode), elevations[peakNode], prominence,
+                      colNode == PeakForest::NONE ? Coords(-1, -1) : nodeCoords(colNode), colElevation);
+  };
+
+  PeakForest forest(nodeCount);
+  size_t nextTileQuery = 0;
+  // Finishes the peaks whose key col lies above the given elevation, before the first node at that elevation is added
+  auto answerQueriesAbove = [&](float elevation)
+  {
+    auto answer = [&](ParentQuery &query)
+    {
+      query.peak.parentCoords = nodeCoords(forest.peakOf(forest.find(query.node)));
+      results.push_back(query.peak);
+    };
+    for (; nextTileQuery < tileQueries.size() && tileQueries[nextTileQuery].colElevation > elevation; ++nextTileQuery)
+      answer(tileQueries[nextTileQuery]);
+    if (!levelQueries.empty() && levelQueries.front().colElevation > elevation)
+    {
+      for (auto &query : levelQueries)
+        answer(query);
+      levelQueries.clear();
+    }
+  };
+  for (uint32_t node : order)
+  {
+    answerQueriesAbove(elevations[node]);
+    uint32_t roots[64];
+    int rootCount = 0;
+    for (uint32_t i = adjacencyStart[node]; i < adjacencyStart[node + 1]; ++i)
+    {
+      if (!forest.contains(adjacency[i]))
+        continue;
+      uint32_t root = forest.find(adjacency[i]);
+      if (find(roots, roots + rootCount, root) == roots + rootCount)
+        roots[rootCount++] = root;
+    }
+
+    forest.makeSet(node);
+    if (rootCount == 0)
+      continue;
+    forest.mergeAtCol(node, roots, rootCount, isHigher, [&](uint32_t lowerRoot, uint32_t winnerRoot)
+                      {
+                        PeakResult peak = peakResult(forest.peakOf(lowerRoot), node);
+                        if (peak.prominence > prominenceThreshold)
+                          levelQueries.push_back({elevations[node], winnerRoot, peak});
+                      });
+  }
+  answerQueriesAbove(-INFINITY);
+
+  for (uint32_t node : order)
+  {
+    if (forest.find(node) == node)
+    {
+      PeakResult peak = peakResult(forest.peakOf(node), PeakForest::NONE);
+      if (peak.prominence > prominenceThreshold)
+        results.push_back(peak);
+    }
+  }
+  return results;
+}
+
+/**
+ * @brief Throws std::runtime_error if the cells of a tile of the given size can not be indexed by processTile.
+ *
+ * processTile numbers the padded cells of a tile with 32-bit indices and keeps PeakForest::NONE free to mark
+ * cells that are not in yet.
+ */
+void checkTileSize(int tileWidth, int tileHeight)
+{
+  if (ElevationGrid::paddedStride(tileWidth) * (size_t(tileHeight) + 2) >= PeakForest::NONE)
+  {
+    throw runtime_error("Tiles of " + to_string(tileWidth) + "x" + to_string(tileHeight) + " pixels are too large for the tiled engine, use a smaller tile size.");
+  }
+}
+
+/**
+ * @brief Reads and sweeps the given tiles of a dataset with processTile, several at a time.
+ *
+ * Only as many tiles as fit in tileMemoryBudget are held at once, one per worker thread, and each worker
+ * sweeps all its tiles in the same TileScratch. Reads are serialized since GDAL datasets are not safe to
+ * read from several threads, and uncompressed float32 files are mapped once so every tile copies its window
+ * straight out of the mapping.
+ *
+ * @param dataset The dataset the tiles are read from.
+ * @param tileIndices Tiles to sweep, numbered row by row.
+ * @param tileWidth Width of a tile, the last column of tiles may be narrower.
+ * @param tileHeight Height of a tile, the last row of tiles may be lower.
+ * @param prominenceThreshold Minimum prominence value for resolved peaks to be kept.
+ * @param tileMemoryBudget Number of bytes the tiles being processed may use together.
+ * @param onTile Called with the index and result of every tile as it finishes, never from two threads at once.
+ * @param verbose If true, the worker count and the read path are printed.
+ */
+void sweepTiles(GDALDataset *dataset, const vector<size_t> &tileIndices, int tileWidth, int tileHeight, int prominenceThreshold, size_t tileMemoryBudget,
+                const function<void(size_t, TileResult &)> &onTile, bool verbose)
+{
+  GDALRasterBand *band = dataset->GetRasterBand(1);
+  int width = band->GetXSize();
+  int height = band->GetYSize();
+  size_t tilesX = (size_t(width) + tileWidth - 1) / tileWidth;
+
+  size_t paddedTileWidth = ElevationGrid::paddedStride(tileWidth);
+  size_t bytesPerTile = paddedTileWidth * (size_t(tileHeight) + 2) * TILE_BYTES_PER_CELL;
+  size_t workerCount = min<size_t>(max<size_t>(tileMemoryBudget / bytesPerTile, 1), max(thread::hardware_concurrency(), 1u));
+  workerCount = min<size_t>(workerCount, tileIndices.size());
+
+  if (verbose)
+    cout << "Processing " << tileIndices.size() << " tiles of " << tileWidth << "x" << tileHeight << " with " << workerCount << " workers\n";
+
+  auto mapping = MappedRaster::open(dataset);
+  if (verbose && mapping)
+    cout << "Reading tiles from a memory map of the file\n";
+
+  mutex readMutex;   // GDAL datasets are not safe to read from several threads
+  mutex outputMutex; // Serializes onTile
+  atomic<size_t> nextTile(0);
+
+  auto worker = [&]()
+  {
+    TileScratch scratch;
+    for (size_t next = nextTile++; next < tileIndices.size(); next = nextTile++)
+    {
+      size_t tileIndex = tileIndices[next];
+      int xOffset = int(tileIndex % tilesX) * tileWidth;
+      int yOffset = int(tileIndex / tilesX) * tileHeight;
+      TileResult result;
+      {
+        unique_lock<mutex> readLock(readMutex);
+        auto tileData = loadRasterWindow(dataset, xOffset, yOffset, min(tileWidth, width - xOffset), min(tileHeight, height - yOffset), mapping.get());
+        readLock.unlock();
+        result = processTile(tileData.second, xOffset, yOffset, width, height, prominenceThreshold, scratch);
+      }
+      lock_guard<mutex> outputLock(outputMutex);
+      onTile(tileIndex, result);
+    }
+  };
+
+  vector<thread> workers;
+  for (size_t i = 0; i < workerCount; ++i)
+    workers.emplace_back(worker);
+  for (auto &t : workers)
+    t.join();
+}
+
+/**
+ * @brief Calculates peak prominences tile by tile, for datasets that do not fit in memory.
+ *
+ * The dataset is split into tiles aligned to its GDAL blocks. Each tile is read on its own, swept with
+ * processTile and released again by sweepTiles. Peaks resolved inside a tile are written straight away,
+ * unless their parent peak may lie in another tile; those and the rest are resolved by stitchTiles, which
+ * only looks at the tile edges and the reduced merge trees. The result is the same as the in-memory
+ * union-find engine.
+ *
+ * @param dataset Unique pointer to the GDALDataset being processed.
+ * @param outputFilePath Path to the output CSV file for storing results.
+ * @param prominenceThreshold Minimum prominence value for peaks to be included in the output.
+ * @param verbose If true, progress information is printed during processing.
+ * @param stats Receives the phase timings and counters of the run.
+ * @param tileSize Requested tile edge length in pixels, rounded up to whole blocks.
+ * @param tileMemoryBudget Number of bytes the tiles being processed may use together.
+ * @param stateFilePath If not empty, the results of every tile are saved there for updateProminenceTiled.
+ */
+void calculateProminenceTiled(unique_ptr<GDALDataset> &dataset, const string outputFilePath, int prominenceThreshold, bool verbose, RunStats &stats, int tileSize, size_t tileMemoryBudget,
+                              const string &stateFilePath)
+{
+  stats.beginPhase("tiles");
+  GDALRasterBand *band = dataset->GetRasterBand(1);
+  int width = band->GetXSize();
+  int height = band->GetYSize();
+  int blockXSize, blockYSize;
+  band->GetBlockSize(&blockXSize, &blockYSize);
+  blockXSize = max(blockXSize, 1);
+  blockYSize = max(blockYSize, 1);
+
+  // Round the tiles up to whole blocks. Striped files have full width blocks, in that case
+  // take as many rows as keeps the tile area close to tileSize * tileSize
+  tileSize = max(tileSize, 1);
+  int tileWidth = int(min<int64_t>(width, (int64_t(tileSize) + blockXSize - 1) / blockXSize * blockXSize));
+  int64_t tileRows = max<int64_t>(1, int64_t(tileSize) * tileSize / tileWidth);
+  int tileHeight = int(min<int64_t>(height, (tileRows + blockYSize - 1) / blockYSize * blockYSize));
+  checkTileSize(tileWidth, tileHeight);
+  size_t tilesX = (size_t(width) + tileWidth - 1) / tileWidth;
+  size_t tilesY = (size_t(height) + tileHeight - 1) / tileHeight;
+  size_t tileCount = tilesX * tilesY;
+
+  unique_ptr<Transformer> coordinateTransformer;
+  if (dataset->GetProjectionRef())
+  {
+    coordinateTransformer = make_unique<Transformer>(dataset.get());
+  }
+  ResultSink output(outputFilePath, prominenceThreshold, std::move(coordinateTransformer));
+
+  bool keepState = !stateFilePath.empty();
+  TileState state{width, height, tileWidth, tileHeight, prominenceThreshold, vector<TileResult>(tileCount)};
+  vector<TileResult> &tiles = state.tiles;
+  vector<size_t> tileIndices(tileCount);
+  for (size_t i = 0; i < tileCount; ++i)
+    tileIndices[i] = i;
+  size_t finishedTiles = 0;
+  sweepTiles(dataset.get(), tileIndices, tileWidth, tileHeight, prominenceThreshold, tileMemoryBudget, [&](size_t tileIndex, TileResult &result)
+             {
+               for (const auto &peak : result.resolvedPeaks)
+                 output.write(peak);
+               size_t finished = ++finishedTiles;
+               stats.progress([&]
+                              { return "tile " + to_string(finished) + "/" + to_string(tileCount) + " kept " + to_string(result.boundaryTree.size()) + " boundary nodes"; });
+               // The resolved peaks are only needed again if the state is saved
+               if (keepState)
+                 tiles[tileIndex].resolvedPeaks = std::move(result.resolvedPeaks);
+               tiles[tileIndex].boundaryTree = std::move(result.boundaryTree);
+               tiles[tileIndex].pendingPeaks = std::move(result.pendingPeaks); }, verbose);
+  dataset.reset();
+
+  stats.beginPhase("stitch");
+  vector<PeakResult> stitchedPeaks = stitchTiles(tiles, width, height, tileWidth, tileHeight, prominenceThreshold);
+  stats.beginPhase("output");
+  for (const auto &peak : stitchedPeaks)
+    output.write(peak);
+  output.close();
+  if (keepState)
+  {
+    stats.beginPhase("state");
+    writeTileState(stateFilePath, state);
+  }
+  stats.endPhase();
+
+  stats.count("cells", uint64_t(width) * height);
+  stats.count("tiles", tileCount);
+  stats.count("peaks_written", output.peakCount());
+}
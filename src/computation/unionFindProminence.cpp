@@ -0,0 +1,46 @@
+#include "gdal_computation.hpp"
+#include "resultSink.hpp"
+#include "../prominence/runStats.hpp"
+#include <iostream>
+#include <memory>
+#include <gdal.h>
+#include <utility>
+#include <gdal_priv.h>
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief Calculates peak prominences in a dataset with a single union-find sweep.
+ *
+ * Loads the dataset and runs unionFindSweep on it, an alternative to the water level engine in
+ * calculateProminence that gives the same peaks.
+ *
+ * @param dataset Unique pointer to the GDALDataset being processed. Released once the raster is loaded.
+ * @param outputFilePath Path to the output CSV file for storing results.
+ * @param prominenceThreshold Minimum prominence value for peaks to be included in the output.
+ * @param verbose If true, the number of peaks written is printed at the end.
+ * @param stats Receives the phase timings and counters of the run.
+ */
+void calculateProminenceUnionFind(unique_ptr<GDALDataset> &dataset, const string outputFilePath, int prominenceThreshold, bool verbose, RunStats &stats)
+{
+  stats.beginPhase("read");
+  auto matrixData = loadRaster(dataset.get());
+
+  unique_ptr<Transformer> coordinateTransformer;
+  if (dataset->GetProjectionRef())
+  {
+    coordinateTransformer = make_unique<Transformer>(dataset.get());
+  }
+  ResultSink output(outputFilePath, prominenceThreshold, std::move(coordinateTransformer));
+  dataset.reset();
+
+  unionFindSweep(matrixData.second, prominenceThreshold, [&output](const PeakResult &peak)
+                 { output.write(peak); }, stats);
+  output.close();
+  stats.endPhase();
+
+  if (verbose)
+    cout << "Found " << output.peakCount() << " peaks above the prominence threshold\n";
+  stats.count("peaks_written", output.peakCount());
+}
@@ -0,0 +1,176 @@
+#include "gdal_computation.hpp"
+#include "resultSink.hpp"
+#include "../prominence/runStats.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+  // Dataset order, which is how peaks are matched up between the two runs
+  bool isBefore(const PeakResult &a, const PeakResult &b)
+  {
+    return a.peakCoords.y < b.peakCoords.y || (a.peakCoords.y == b.peakCoords.y && a.peakCoords.x < b.peakCoords.x);
+  }
+
+  // All peaks of a tile state: the ones every tile resolved on its own and the ones stitching resolves
+  vector<PeakResult> allPeaks(const TileState &state)
+  {
+    vector<PeakResult> peaks = stitchTiles(state.tiles, state.datasetWidth, state.datasetHeight, state.tileWidth, state.tileHeight, state.prominenceThreshold);
+    for (const TileResult &tile : state.tiles)
+      peaks.insert(peaks.end(), tile.resolvedPeaks.begin(), tile.resolvedPeaks.end());
+    sort(peaks.begin(), peaks.end(), isBefore);
+    return peaks;
+  }
+
+  bool samePeak(const PeakResult &a, const PeakResult &b)
+  {
+    auto sameValue = [](double x, double y)
+    {
+      return x == y || (isnan(x) && isnan(y));
+    };
+    return a.elevation == b.elevation && a.prominence == b.prominence && a.colCoords.x == b.colCoords.x && a.colCoords.y == b.colCoords.y &&
+           sameValue(a.colElevation, b.colElevation) && a.parentCoords.x == b.parentCoords.x && a.parentCoords.y == b.parentCoords.y;
+  }
+}
+
+/**
+ * @brief Brings a saved tiled run up to date after part of the dataset changed, and writes what changed.
+ *
+ * Prominence is not local, but a tile's reduced merge tree only depends on the tile's own cells. So only the
+ * tiles that overlap the changed window are read and swept again; every other tile keeps its saved result.
+ * Stitching then redoes the merges across tile edges for all tiles, which only looks at the boundary nodes
+ * and is quick compared to sweeping the raster. The peaks before and after are compared peak by peak.
+ *
+ * The output has one row per peak that appeared, disappeared or whose prominence, key col or parent changed,
+ * with the CSV columns of a run after a change column ("added", "removed" or "changed") and followed by the
+ * previous prominence, which is empty for added peaks. Removed peaks show their previous values. The state file is replaced by the updated
+ * one, so updates can follow each other. The threshold and tile layout are the ones the state was saved with.
+ *
+ * @param dataset The updated dataset, with the same size as the one the state was saved from.
+ * @param stateFilePath State written by calculateProminenceTiled with -state, replaced by the updated state.
+ * @param windowX Column of the dataset where the changed window starts.
+ * @param windowY Row of the dataset where the changed window starts.
+ * @param windowWidth Width of the changed window.
+ * @param windowHeight Height of the changed window.
+ * @param outputFilePath Path of the CSV file the changes are written to, or empty to print them to stdout.
+ * @param verbose If true, progress information is printed during processing.
+ * @param stats Receives the phase timings and counters of the run.
+ * @param tileMemoryBudget Number of bytes the tiles being processed may use together.
+ */
+void updateProminenceTiled(unique_ptr<GDALDataset> &dataset, const string &stateFilePath, int windowX, int windowY, int windowWidth, int windowHeight,
+                           const string outputFilePath, bool verbose, RunStats &stats, size_t tileMemoryBudget)
+{
+  stats.beginPhase("state");
+  TileState state = readTileState(stateFilePath);
+  GDALRasterBand *band = dataset->GetRasterBand(1);
+  if (band->GetXSize() != state.datasetWidth || band->GetYSize() != state.datasetHeight)
+    throw runtime_error("The dataset is " + to_string(band->GetXSize()) + "x" + to_string(band->GetYSize()) + " but the state was saved from a " +
+                        to_string(state.datasetWidth) + "x" + to_string(state.datasetHeight) + " dataset");
+  checkTileSize(state.tileWidth, state.tileHeight);
+
+  stats.beginPhase("stitch");
+  vector<PeakResult> previousPeaks = allPeaks(state);
+
+  // Every tile the window overlaps, clipped to the dataset
+  stats.beginPhase("tiles");
+  size_t tilesX = (size_t(state.datasetWidth) + state.tileWidth - 1) / state.tileWidth;
+  int firstX = max(windowX, 0);
+  int firstY = max(windowY, 0);
+  int lastX = int(min<int64_t>(int64_t(windowX) + windowWidth, state.datasetWidth)) - 1;
+  int lastY = int(min<int64_t>(int64_t(windowY) + windowHeight, state.datasetHeight)) - 1;
+  vector<size_t> tileIndices;
+  for (int tileY = firstY / state.tileHeight; firstX <= lastX && tileY <= lastY / state.tileHeight; ++tileY)
+  {
+    for (int tileX = firstX / state.tileWidth; tileX <= lastX / state.tileWidth; ++tileX)
+      tileIndices.push_back(size_t(tileY) * tilesX + size_t(tileX));
+  }
+  if (verbose)
+    cout << "Sweeping " << tileIndices.size() << " of " << state.tiles.size() << " tiles again\n";
+  sweepTiles(dataset.get(), tileIndices, state.tileWidth, state.tileHeight, state.prominenceThreshold, tileMemoryBudget, [&](size_t tileIndex, TileResult &result)
+             { state.tiles[tileIndex] = std::move(result); }, verbose);
+
+  stats.beginPhase("stitch");
+  vector<PeakResult> peaks = allPeaks(state);
+
+  stats.beginPhase("output");
+  vector<pair<const char *, const PeakResult *>> changes;
+  vector<double> previousProminences;
+  size_t previous = 0;
+  for (size_t i = 0; i <= peaks.size(); ++i)
+  {
+    for (; previous < previousPeaks.size() && (i == peaks.size() || isBefore(previousPeaks[previous], peaks[i])); ++previous)
+    {
+      changes.emplace_back("removed", &previousPeaks[previous]);
+      previousProminences.push_back(previousPeaks[previous].prominence);
+    }
+    if (i == peaks.size())
+      break;
+    if (previous < previousPeaks.size() && !isBefore(peaks[i], previousPeaks[previous]))
+    {
+      if (!samePeak(peaks[i], previousPeaks[previous]))
+      {
+        changes.emplace_back("changed", &peaks[i]);
+        previousProminences.push_back(previousPeaks[previous].prominence);
+      }
+      ++previous;
+    }
+    else
+    {
+      changes.emplace_back("added", &peaks[i]);
+      previousProminences.push_back(NAN);
+    }
+  }
+
+  vector<int> xs, ys;
+  for (const auto &change : changes)
+  {
+    xs.push_back(change.second->peakCoords.x);
+    ys.push_back(change.second->peakCoords.y);
+  }
+  vector<double> latitudes(changes.size(), NAN), longitudes(changes.size(), NAN);
+  if (dataset->GetProjectionRef())
+    Transformer(dataset.get()).transform(changes.size(), xs.data(), ys.data(), latitudes.data(), longitudes.data());
+  dataset.reset();
+
+  // Peaks are formatted by ResultSink like in the output of a run, between the change and the previous prominence
+  string text = string("change,") + ResultSink::CSV_COLUMNS + ",previous_prominence\n";
+  for (size_t i = 0; i < changes.size(); ++i)
+  {
+    text += changes[i].first;
+    text += ',';
+    ResultSink::appendCsvFields(text, *changes[i].second, latitudes[i], longitudes[i]);
+    text += ',';
+    // Empty for peaks that are new
+    if (!isnan(previousProminences[i]))
+      ResultSink::appendCsvDecimal(text, previousProminences[i]);
+    text += '\n';
+  }
+  if (outputFilePath.empty())
+    cout << text;
+  else
+  {
+    ofstream file(outputFilePath, ios::binary | ios::trunc);
+    if (!file.is_open())
+      throw runtime_error("Unable to open output file: " + outputFilePath);
+    file << text;
+  }
+
+  stats.beginPhase("state");
+  writeTileState(stateFilePath, state);
+  stats.endPhase();
+
+  if (verbose)
+    cout << changes.size() << " of " << peaks.size() << " peaks changed\n";
+  stats.count("tiles", state.tiles.size());
+  stats.count("tiles_swept", tileIndices.size());
+  stats.count("peaks", peaks.size());
+  stats.count("peaks_changed", changes.size());
+}
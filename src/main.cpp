@@ -5,11 +5,14 @@
 #include <vector>
 #include <gdal_priv.h>
 
+#include <climits>
 #include <string>
+#include <sstream>
 
 #include <ogr_spatialref.h>
 #include "visualization/visualizeTif.hpp"
 #include "computation/gdal_computation.hpp"
+#include "prominence/runStats.hpp"
 
 using namespace std;
 
@@ -36,15 +39,34 @@ int main(int argc, char *argv[])
 
   if (argc <= 1)
   {
-    cerr << "Usage: " << argv[0] << " <FileName.tiff> [-o output.csv] [-v]" << endl;
+    cerr << "Usage: " << argv[0] << " <FileName.tiff> [-o output.csv] [-threshold n] [-engine waterlevel|unionfind] [-step m] [-serial] [-pyramid] [-tiled [-tile-size px] [-tile-memory MB] [-state run.pft]] [-batch-memory MB] [-stats summary.json] [-verbose]" << endl;
+    cerr << "The input can also be a list of files (.txt or .list, one per line) or a quoted glob pattern, their peaks are written to one output" << endl;
+    cerr << "A tiled run with -state run.pft can later be updated after part of the dataset changed, writing the changed peaks: " << argv[0]
+         << " <FileName.tiff> -update run.pft [-window x,y,width,height] [-o changes.csv]" << endl;
+    cerr << "With -o peaks.pfi a run writes a peak index, which can then be queried: " << argv[0] << " <peaks.pfi> [-o output.csv] [-threshold n] [-bbox minLon,minLat,maxLon,maxLat]" << endl;
     return EXIT_FAILURE;
   }
 
   string demFilePath = argv[1];
   string outputFilePath;
+  string statsFilePath;
   int prominenceThreshold = 0;
   bool visualize = false;
   bool verbose = false;
+  string engine = "waterlevel";
+  bool tiled = false;
+  int tileSize = 4096;
+  size_t tileMemoryMB = 4096;
+  size_t batchMemoryMB = 4096;
+  double waterLevelStep = 1;
+  bool parallelExpansion = true;
+  bool pyramidPrePass = false;
+  bool stepGiven = false;
+  PeakIndex::Box queryBox;
+  string stateFilePath;
+  string updateFilePath;
+  int window[4] = {0, 0, INT_MAX, INT_MAX}; // Whole dataset unless -window is given
+  bool windowGiven = false;
 
   for (int i = 2; i < argc; i++)
   {
@@ -61,11 +83,92 @@ int main(int argc, char *argv[])
     {
       outputFilePath = argv[++i]; // Increment i to skip the next argument as it is the file path for -o
     }
+    else if (arg == "-stats" && i + 1 < argc)
+    {
+      statsFilePath = argv[++i];
+    }
     else if (arg == "-threshold" && i + 1 < argc)
     {
       i++;
       prominenceThreshold = stoi(argv[i]);
     }
+    else if (arg == "-bbox" && i + 1 < argc)
+    {
+      char separator;
+      istringstream box(argv[++i]);
+      if (!(box >> queryBox.minLongitude >> separator >> queryBox.minLatitude >> separator >> queryBox.maxLongitude >> separator >> queryBox.maxLatitude))
+      {
+        cerr << "The bounding box has to be given as minLon,minLat,maxLon,maxLat" << endl;
+        return EXIT_FAILURE;
+      }
+    }
+    else if (arg == "-state" && i + 1 < argc)
+    {
+      stateFilePath = argv[++i];
+    }
+    else if (arg == "-update" && i + 1 < argc)
+    {
+      updateFilePath = argv[++i];
+    }
+    else if (arg == "-window" && i + 1 < argc)
+    {
+      char separator;
+      istringstream text(argv[++i]);
+      if (!(text >> window[0] >> separator >> window[1] >> separator >> window[2] >> separator >> window[3]) || window[2] <= 0 || window[3] <= 0)
+      {
+        cerr << "The changed window has to be given as x,y,width,height in pixels, with a positive width and height" << endl;
+        return EXIT_FAILURE;
+      }
+      windowGiven = true;
+    }
+    else if (arg == "-tiled")
+    {
+      tiled = true;
+    }
+    else if (arg == "-tile-size" && i + 1 < argc)
+    {
+      tileSize = stoi(argv[++i]);
+      if (tileSize <= 0)
+      {
+        cerr << "The tile size has to be a positive number of pixels" << endl;
+        return EXIT_FAILURE;
+      }
+    }
+    else if (arg == "-tile-memory" && i + 1 < argc)
+    {
+      tileMemoryMB = stoul(argv[++i]);
+    }
+    else if (arg == "-batch-memory" && i + 1 < argc)
+    {
+      batchMemoryMB = stoul(argv[++i]);
+    }
+    else if (arg == "-step" && i + 1 < argc)
+    {
+      waterLevelStep = stod(argv[++i]);
+      stepGiven = true;
+      if (waterLevelStep < 0)
+      {
+        cerr << "The water level step can not be negative" << endl;
+        return EXIT_FAILURE;
+      }
+    }
+    else if (arg == "-pyramid")
+    {
+      pyramidPrePass = true;
+    }
+    else if (arg == "-serial")
+    {
+      parallelExpansion = false;
+    }
+    else if (arg == "-engine" && i + 1 < argc)
+    {
+      engine = argv[++i];
+      if (engine != "waterlevel" && engine != "unionfind")
+      {
+        cerr << "Unknown engine: " << engine << endl;
+        return EXIT_FAILURE;
+      }
+    }
     else
     {
       cerr << "Unknown option: " << arg << endl;
@@ -73,12 +176,92 @@ int main(int argc, char *argv[])
     }
   }
 
+  if (windowGiven && updateFilePath.empty())
+  {
+    cerr << "-window tells an -update which part of the dataset changed and needs -update" << endl;
+    return EXIT_FAILURE;
+  }
+
+  // The pre-pass is exact only if the water stops at every distinct elevation
+  if (pyramidPrePass)
+  {
+    if (engine != "waterlevel" || tiled)
+    {
+      cerr << "-pyramid only applies to the water level engine" << endl;
+      return EXIT_FAILURE;
+    }
+    if (stepGiven && waterLevelStep != 0)
+    {
+      cerr << "-pyramid needs a water level step of 0" << endl;
+      return EXIT_FAILURE;
+    }
+    waterLevelStep = 0;
+  }
+
   if (visualize)
   {
     visualizeTif(demFilePath);
     return 0;
   }
 
+  // An index answers threshold and area queries without the raster
+  if (demFilePath.ends_with(".pfi"))
+  {
+    size_t peakCount;
+    try
+    {
+      peakCount = queryPeakIndex(demFilePath, outputFilePath, prominenceThreshold, queryBox);
+    }
+    catch (const exception &e)
+    {
+      cerr << e.what() << endl;
+      return EXIT_FAILURE;
+    }
+    if (verbose)
+      cerr << peakCount << " peaks match" << endl;
+    return EXIT_SUCCESS;
+  }
+
+  // A list file or a glob pattern runs every dataset in this process, into one output
+  vector<string> inputFiles = listInputFiles(demFilePath);
+  if (inputFiles.size() != 1 || inputFiles[0] != demFilePath)
+  {
+    if (inputFiles.empty())
+    {
+      cerr << "No files match: " << demFilePath << endl;
+      return EXIT_FAILURE;
+    }
+    if (tiled || !updateFilePath.empty())
+    {
+      cerr << "The tiled engine works on a single dataset, build a VRT of the files to process them as one mosaic" << endl;
+      return EXIT_FAILURE;
+    }
+    if (outputFilePath.ends_with(".pfc") || outputFilePath.ends_with(".pfi"))
+    {
+      cerr << "The peaks of several files are written to CSV, which says which file every peak is from" << endl;
+      return EXIT_FAILURE;
+    }
+    ProminenceOptions options;
+    options.engine = engine == "unionfind" ? ProminenceEngine::UnionFind : ProminenceEngine::WaterLevel;
+    options.prominenceThreshold = prominenceThreshold;
+    options.waterLevelStep = waterLevelStep;
+    options.parallelExpansion = parallelExpansion;
+    options.pyramidPrePass = pyramidPrePass;
+    RunStats stats(engine, verbose);
+    try
+    {
+      calculateProminenceBatch(inputFiles, outputFilePath, options, verbose, stats, batchMemoryMB * 1024 * 1024);
+    }
+    catch (const exception &e)
+    {
+      cerr << e.what() << endl;
+      return EXIT_FAILURE;
+    }
+    if (!statsFilePath.empty())
+      stats.writeJson(statsFilePath);
+    return EXIT_SUCCESS;
+  }
+
   unique_ptr<GDALDataset> dataset(static_cast<GDALDataset *>(GDALOpen(demFilePath.c_str(), GA_ReadOnly)));
 
   if (dataset == nullptr)
@@ -87,8 +270,33 @@ int main(int argc, char *argv[])
     return 1;
   }
 
-  // Calculate prominence
-  calculateProminence(dataset, outputFilePath, prominenceThreshold, verbose);
+  if (!stateFilePath.empty() && !tiled)
+  {
+    cerr << "-state saves the tiles of a tiled run and needs -tiled" << endl;
+    return EXIT_FAILURE;
+  }
+
+  // Calculate prominence. Invalid state files, datasets too large for an engine and the like are reported
+  RunStats stats(!updateFilePath.empty() ? "update" : tiled ? "tiled" : engine, verbose);
+  try
+  {
+    if (!updateFilePath.empty())
+      updateProminenceTiled(dataset, updateFilePath, window[0], window[1], window[2], window[3], outputFilePath, verbose, stats, tileMemoryMB * 1024 * 1024);
+    else if (tiled)
+      calculateProminenceTiled(dataset, outputFilePath, prominenceThreshold, verbose, stats, tileSize, tileMemoryMB * 1024 * 1024, stateFilePath);
+    else if (engine == "unionfind")
+      calculateProminenceUnionFind(dataset, outputFilePath, prominenceThreshold, verbose, stats);
+    else
+      calculateProminence(dataset, outputFilePath, prominenceThreshold, verbose, stats, waterLevelStep, parallelExpansion, pyramidPrePass);
+  }
+  catch (const exception &e)
+  {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  if (!statsFilePath.empty())
+    stats.writeJson(statsFilePath);
 
   return EXIT_SUCCESS;
 }
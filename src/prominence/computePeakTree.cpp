@@ -0,0 +1,41 @@
+#include "prominence.hpp"
+#include "runStats.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Computes the prominence tree of an in-memory raster, see prominence.hpp.
+ *
+ * The engines resolve the parent of every peak during the sweep, so linking them only needs the peaks:
+ * their cell indices are sorted once and every parent is found by binary search.
+ */
+PeakTree computePeakTree(const RasterView &view, const ProminenceOptions &options, RunStats *stats)
+{
+  PeakTree tree;
+  computeProminence(view, options, tree.peaks, stats);
+
+  auto cellOf = [&view](const Coords &coords)
+  {
+    return uint64_t(coords.y) * uint64_t(view.width) + uint64_t(coords.x);
+  };
+  vector<pair<uint64_t, uint32_t>> byCell(tree.peaks.size());
+  for (size_t i = 0; i < tree.peaks.size(); ++i)
+    byCell[i] = {cellOf(tree.peaks[i].peakCoords), uint32_t(i)};
+  sort(byCell.begin(), byCell.end());
+
+  tree.parents.assign(tree.peaks.size(), PeakTree::NO_PARENT);
+  for (size_t i = 0; i < tree.peaks.size(); ++i)
+  {
+    const Coords &parent = tree.peaks[i].parentCoords;
+    if (parent.x < 0)
+      continue;
+    auto found = lower_bound(byCell.begin(), byCell.end(), make_pair(cellOf(parent), uint32_t(0)));
+    if (found != byCell.end() && found->first == cellOf(parent))
+      tree.parents[i] = found->second;
+  }
+  return tree;
+}
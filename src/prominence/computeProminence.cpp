@@ -0,0 +1,31 @@
+#include "prominence.hpp"
+#include "runStats.hpp"
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Computes the prominence of every peak in an in-memory raster, see prominence.hpp.
+ *
+ * The raster is copied with gridFromView and handed to the engine chosen in the options. This is what
+ * the CLI runs as well, except that it loads the grid through GDAL and writes the peaks to a file.
+ */
+void computeProminence(const RasterView &view, const ProminenceOptions &options, const PeakCallback &emit, RunStats *stats)
+{
+  RunStats localStats;
+  RunStats &runStats = stats ? *stats : localStats;
+
+  runStats.beginPhase("read");
+  auto matrixData = gridFromView(view);
+  if (options.engine == ProminenceEngine::UnionFind)
+    unionFindSweep(matrixData.second, options.prominenceThreshold, emit, runStats);
+  else
+    waterLevelSweep(matrixData.second, matrixData.first, options.prominenceThreshold, options.waterLevelStep, options.parallelExpansion, options.pyramidPrePass, emit, runStats);
+  runStats.endPhase();
+}
+
+void computeProminence(const RasterView &view, const ProminenceOptions &options, vector<PeakResult> &peaks, RunStats *stats)
+{
+  computeProminence(view, options, [&peaks](const PeakResult &peak)
+                    { peaks.push_back(peak); }, stats);
+}
@@ -0,0 +1,149 @@
+#include "prominenceCore.hpp"
+#include "taskPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Grows the islands that are due at a water level in parallel, as far as they do not touch each other.
+ *
+ * Every due island is first grown speculatively on the shared TaskPool, exactly like the serial loop in
+ * waterLevelSweep would grow it, except that new points are claimed with an atomic compare and swap and
+ * nothing is merged. Whenever an island runs into a point owned or just claimed by another island, both are
+ * marked as in contact. The growth of islands that touched nobody does not depend on any other island, so it
+ * is committed as is. Islands in contact give their claimed points back and are returned, to be grown by the
+ * serial loop in id order. The speculation explores everything those islands can reach at this level, so
+ * nothing they do in the serial loop can reach a committed island, and the result is bit-identical to growing
+ * every island serially.
+ *
+ * With raisePeaks, a committed island that claimed points above its peak takes the highest of them as its
+ * peak, like the serial loop does for the land of pruned peaks.
+ *
+ * @param dueIslands Ids of the islands due at the level, in ascending order. Left holding the ids of the islands
+ * that touched another island, still in ascending order.
+ * @param levelIndex Index of the current water level.
+ * @param levels The water levels, highest first.
+ * @param islands The island table, the island with id i is at index i - 1.
+ * @param grid The elevation grid and the island id of every point.
+ * @param owners Which island every island id has been absorbed into. Only read.
+ * @param frontierPool The pool all frontiers are stored in.
+ * @param schedule Committed islands are listed again at the level their frontier is due next.
+ * @param buffers Scratch space of the workers, reused from level to level.
+ * @param raisePeaks True when the pyramid pre-pass dropped peaks, see waterLevelSweep.
+ */
+void expandIslandsInParallel(vector<unsigned int> &dueIslands, uint32_t levelIndex, const vector<float> &levels, vector<Island> &islands, ElevationGrid &grid, const IslandOwners &owners, FrontierPool &frontierPool, IslandSchedule &schedule, ParallelGrowthBuffers &buffers, bool raisePeaks)
+{
+  TaskPool &pool = TaskPool::shared();
+  const float *elevations = grid.elevations();
+  uint32_t *islandIds = grid.islandIds();
+  const auto neighborOffsets = grid.neighborOffsets();
+  const float waterLevel = levels[levelIndex];
+  auto levelIndexBelow = [&levels](float elevation)
+  {
+    return uint32_t(lower_bound(levels.begin(), levels.end(), elevation, greater<float>()) - levels.begin());
+  };
+
+  // Contacts are stored as the level index + 1, so the marks of earlier levels never need clearing
+  auto markContact = [&islands, levelIndex](unsigned int id)
+  {
+    atomic_ref<uint32_t>(islands[id - 1].contactLevel).store(levelIndex + 1, memory_order_relaxed);
+  };
+
+  for (ParallelGrowthBuffers::Worker &buffer : buffers.workers)
+  {
+    buffer.claimed.clear();
+    buffer.deferred.clear();
+  }
+  vector<ParallelGrowthBuffers::Growth> &growth = buffers.growth;
+  growth.resize(dueIslands.size());
+  pool.parallelFor(dueIslands.size(), 1, [&](size_t begin, size_t end, unsigned worker)
+                   {
+                     ParallelGrowthBuffers::Worker &buffer = buffers.workers[worker];
+                     for (size_t i = begin; i < end; ++i)
+                     {
+                       const Island &island = islands[dueIslands[i] - 1];
+                       ParallelGrowthBuffers::Growth &grown = growth[i];
+                       grown.worker = worker;
+                       grown.claimedBegin = buffer.claimed.size();
+                       grown.deferredBegin = buffer.deferred.size();
+                       grown.highestClaimed = UINT32_MAX;
+                       size_t peakIndex = grid.index(island.peakCoords.x, island.peakCoords.y);
+
+                       // The points popped at this level come out of the frontier first and then in the order they are claimed
+                       buffer.queue.clear();
+                       island.frontier.forEachDue(frontierPool, levelIndex, [&buffer](uint32_t cell)
+                                                  { buffer.queue.push_back(cell); });
+                       for (size_t next = 0; next < buffer.queue.size(); ++next)
+                       {
+                         uint32_t frontierIndex = buffer.queue[next];
+                         float highestUnderwater = -INFINITY;
+                         for (ptrdiff_t offset : neighborOffsets)
+                         {
+                           size_t neighborIndex = frontierIndex + offset;
+                           float neighborElevation = elevations[neighborIndex];
+                           if (neighborElevation < waterLevel)
+                           {
+                             highestUnderwater = max(highestUnderwater, neighborElevation);
+                             continue;
+                           }
+                           atomic_ref<uint32_t> neighborId(islandIds[neighborIndex]);
+                           uint32_t neighborIslandId = neighborId.load(memory_order_relaxed);
+                           if (neighborIslandId == island.id)
+                             continue;
+                           if (neighborIslandId == 0 && neighborId.compare_exchange_strong(neighborIslandId, island.id, memory_order_relaxed))
+                           {
+                             buffer.claimed.push_back(uint32_t(neighborIndex));
+                             // Row-major order breaks ties, like in the serial loop
+                             size_t highest = grown.highestClaimed == UINT32_MAX ? peakIndex : grown.highestClaimed;
+                             if (raisePeaks && (neighborElevation > elevations[highest] || (neighborElevation == elevations[highest] && neighborIndex < highest)))
+                               grown.highestClaimed = uint32_t(neighborIndex);
+                             buffer.queue.push_back(uint32_t(neighborIndex));
+                             continue;
+                           }
+                           // Owned by, or just claimed by, another island. This is where the serial loop would find a key col
+                           unsigned int ownerId = owners.peekOwner(neighborIslandId);
+                           if (ownerId != island.id)
+                           {
+                             markContact(island.id);
+                             markContact(ownerId);
+                           }
+                         }
+                         if (highestUnderwater != -INFINITY)
+                           buffer.deferred.emplace_back(levelIndexBelow(highestUnderwater), frontierIndex);
+                       }
+
+                       grown.claimedEnd = buffer.claimed.size();
+                       grown.deferredEnd = buffer.deferred.size();
+                     } });
+
+  // The islands in contact are compacted to the front of dueIslands, never past the island being read
+  size_t inContactCount = 0;
+  for (size_t i = 0; i < dueIslands.size(); ++i)
+  {
+    Island &island = islands[dueIslands[i] - 1];
+    const ParallelGrowthBuffers::Growth &grown = growth[i];
+    const ParallelGrowthBuffers::Worker &buffer = buffers.workers[grown.worker];
+    if (island.contactLevel == levelIndex + 1)
+    {
+      for (size_t claimed = grown.claimedBegin; claimed < grown.claimedEnd; ++claimed)
+        islandIds[buffer.claimed[claimed]] = 0;
+      dueIslands[inContactCount++] = island.id;
+      continue;
+    }
+    if (grown.highestClaimed != UINT32_MAX)
+    {
+      island.elevation = elevations[grown.highestClaimed];
+      island.peakCoords = grid.coords(grown.highestClaimed);
+    }
+    island.frontier.dropDue(frontierPool, levelIndex);
+    for (size_t deferred = grown.deferredBegin; deferred < grown.deferredEnd; ++deferred)
+      island.frontier.push(frontierPool, buffer.deferred[deferred].first, buffer.deferred[deferred].second);
+    if (!island.frontier.empty())
+      schedule.schedule(island.id, island.frontier.nextLevel());
+  }
+  dueIslands.resize(inContactCount);
+}
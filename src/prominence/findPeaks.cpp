@@ -0,0 +1,304 @@
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <iostream>
+#include <utility>
+#include <queue>
+#include "prominenceCore.hpp"
+#include "taskPool.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define PEAKFINDER_AVX2_KERNEL
+#endif
+
+using namespace std;
+
+/**
+ * @brief Processes a range/chunk from the dataset and adds the coordinates of all local maxima to a candidate buffer
+ *
+ * Generic version for any isolation radius. The common radius of 1 is handled by the findRowMaxima kernels instead.
+ *
+ * @param grid The loaded elevation raster, "No Data" points are stored as -infinity
+ * @param candidates The buffer to append the coordinates of local maxima to
+ * @param startRow The starting point of the range
+ * @param endRow The end point of the range
+ * @param isolationRadius In what pixel radius the peak has to be the highest. Usually 1 but left as a parameter for future iterations.
+ */
+void processRange(const ElevationGrid &grid, vector<Coords> &candidates, int startRow, int endRow, int isolationRadius)
+
+{
+  int width = grid.width;
+  int height = grid.height;
+  for (int y = startRow; y < endRow; ++y) // Adjusted to include edge pixels
+  {
+    const float *row = grid.row(y);
+    for (int x = 0; x < width; ++x) // Adjusted to include edge pixels
+    {
+      float current = row[x];
+      // "No Data" points are loaded as -infinity
+      if (current == -INFINITY)
+      {
+        continue;
+      }
+
+      bool isPeak = true;
+
+      for (int ny = -isolationRadius; ny <= isolationRadius; ++ny)
+      {
+        for (int nx = -isolationRadius; nx <= isolationRadius; ++nx)
+        {
+          // Skip the current point itself
+          if (nx == 0 && ny == 0)
+            continue;
+
+          int neighborX = x + nx;
+          int neighborY = y + ny;
+
+          // Boundary check
+          if (neighborX < 0 || neighborX >= width || neighborY < 0 || neighborY >= height)
+            continue; // Skip this neighbor if it's out of bounds
+
+          if (grid.row(neighborY)[neighborX] >= current)
+          {
+            isPeak = false;
+            break;
+          }
+        }
+        if (!isPeak)
+          break;
+      }
+
+      if (isPeak)
+      {
+        candidates.emplace_back(x, y);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Buffers a worker fills while scanning rows for local maxima.
+ */
+struct PeakCandidates
+{
+  vector<Coords> peaks;         // Points strictly higher than all eight neighbours
+  vector<Coords> plateauSeeds;  // Points with an equally high neighbour and no higher one
+};
+
+/**
+ * @brief Scans row y for local maxima and possible flat summits.
+ *
+ * Scalar kernel for an isolation radius of 1. Points strictly higher than all eight neighbours are peaks.
+ * Points with no higher neighbour but at least one equally high one may be part of a flat summit and are
+ * recorded as plateau seeds for resolvePlateaus. Relies on the -infinity border of the grid, so it needs no
+ * bounds checks, and "No Data" points are never reported.
+ *
+ * @param grid The loaded elevation raster
+ * @param y The row to scan
+ * @param candidates The buffers to append to
+ * @param startX First column to scan
+ */
+void findRowMaximaScalar(const ElevationGrid &grid, int y, PeakCandidates &candidates, int startX = 0)
+{
+  const float *above = grid.row(y - 1);
+  const float *row = grid.row(y);
+  const float *below = grid.row(y + 1);
+  for (int x = startX; x < grid.width; ++x)
+  {
+    float current = row[x];
+    float highestNeighbor = max({above[x - 1], above[x], above[x + 1], row[x - 1], row[x + 1], below[x - 1], below[x], below[x + 1]});
+    if (current > highestNeighbor)
+      candidates.peaks.emplace_back(x, y);
+    else if (current == highestNeighbor && current != -INFINITY)
+      candidates.plateauSeeds.emplace_back(x, y);
+  }
+}
+
+#ifdef PEAKFINDER_AVX2_KERNEL
+/**
+ * @brief AVX2 version of findRowMaximaScalar that compares eight points against their neighbours at a time.
+ *
+ * The neighbour loads may reach one point into the padding on either side of the row, which the grid
+ * guarantees to be there.
+ */
+__attribute__((target("avx2"))) void findRowMaximaAvx2(const ElevationGrid &grid, int y, PeakCandidates &candidates)
+{
+  const float *above = grid.row(y - 1);
+  const float *row = grid.row(y);
+  const float *below = grid.row(y + 1);
+  const __m256 noData = _mm256_set1_ps(-INFINITY);
+  int x = 0;
+  for (; x + 8 <= grid.width; x += 8)
+  {
+    __m256 current = _mm256_loadu_ps(row + x);
+    __m256 highestNeighbor = _mm256_max_ps(_mm256_loadu_ps(row + x - 1), _mm256_loadu_ps(row + x + 1));
+    highestNeighbor = _mm256_max_ps(highestNeighbor, _mm256_loadu_ps(above + x - 1));
+    highestNeighbor = _mm256_max_ps(highestNeighbor, _mm256_loadu_ps(above + x));
+    highestNeighbor = _mm256_max_ps(highestNeighbor, _mm256_loadu_ps(above + x + 1));
+    highestNeighbor = _mm256_max_ps(highestNeighbor, _mm256_loadu_ps(below + x - 1));
+    highestNeighbor = _mm256_max_ps(highestNeighbor, _mm256_loadu_ps(below + x));
+    highestNeighbor = _mm256_max_ps(highestNeighbor, _mm256_loadu_ps(below + x + 1));
+
+    unsigned peakMask = unsigned(_mm256_movemask_ps(_mm256_cmp_ps(current, highestNeighbor, _CMP_GT_OQ)));
+    __m256 isSeed = _mm256_and_ps(_mm256_cmp_ps(current, highestNeighbor, _CMP_EQ_OQ), _mm256_cmp_ps(current, noData, _CMP_NEQ_OQ));
+    unsigned seedMask = unsigned(_mm256_movemask_ps(isSeed));
+    while (peakMask)
+    {
+      candidates.peaks.emplace_back(x + __builtin_ctz(peakMask), y);
+      peakMask &= peakMask - 1;
+    }
+    while (seedMask)
+    {
+      candidates.plateauSeeds.emplace_back(x + __builtin_ctz(seedMask), y);
+      seedMask &= seedMask - 1;
+    }
+  }
+  findRowMaximaScalar(grid, y, candidates, x);
+}
+#endif
+
+/**
+ * @brief Picks the fastest local maximum kernel the CPU supports, once per process.
+ */
+void (*selectRowMaximaKernel())(const ElevationGrid &, int, PeakCandidates &)
+{
+#ifdef PEAKFINDER_AVX2_KERNEL
+  if (__builtin_cpu_supports("avx2"))
+    return findRowMaximaAvx2;
+#endif
+  return [](const ElevationGrid &grid, int y, PeakCandidates &candidates)
+  {
+    findRowMaximaScalar(grid, y, candidates);
+  };
+}
+
+/**
+ * @brief Turns plateau seeds into one peak per flat summit.
+ *
+ * Every seed that has not been visited yet starts a flood fill over the connected points of exactly the
+ * same elevation. The plateau is a summit if none of its points has a higher neighbour, in which case its
+ * first point in row-major order becomes the peak. Each plateau point is visited once, so the pass is
+ * linear in the size of the flat areas no matter how many seeds they contain.
+ *
+ * @param grid The loaded elevation raster
+ * @param plateauSeeds Seeds found by the row kernels, in row-major order
+ * @param peaks The buffer to append the peaks of flat summits to
+ */
+void resolvePlateaus(const ElevationGrid &grid, const vector<Coords> &plateauSeeds, vector<Coords> &peaks)
+{
+  if (plateauSeeds.empty())
+    return;
+  const float *elevations = grid.elevations();
+  const auto neighborOffsets = grid.neighborOffsets();
+  vector<bool> visited(grid.size(), false);
+  vector<size_t> stack;
+
+  for (const Coords &seed : plateauSeeds)
+  {
+    size_t seedIndex = grid.index(seed.x, seed.y);
+    if (visited[seedIndex])
+      continue;
+    float plateauElevation = elevations[seedIndex];
+    bool isSummit = true;
+    size_t firstIndex = seedIndex;
+
+    visited[seedIndex] = true;
+    stack.push_back(seedIndex);
+    while (!stack.empty())
+    {
+      size_t index = stack.back();
+      stack.pop_back();
+      firstIndex = min(firstIndex, index);
+      for (ptrdiff_t offset : neighborOffsets)
+      {
+        size_t neighborIndex = index + offset;
+        float neighborElevation = elevations[neighborIndex];
+        if (neighborElevation > plateauElevation)
+        {
+          isSummit = false;
+        }
+        else if (neighborElevation == plateauElevation && !visited[neighborIndex])
+        {
+          visited[neighborIndex] = true;
+          stack.push_back(neighborIndex);
+        }
+      }
+    }
+
+    if (isSummit)
+      peaks.push_back(grid.coords(firstIndex));
+  }
+}
+
+/**
+ * @brief Finds peak islands within a dataset.
+ *
+ * Identifies and returns a collection of islands that represent peaks in the given dataset, with one peak
+ * for every flat summit (see resolvePlateaus). The rows are scanned on the shared TaskPool in small bands,
+ * and every worker writes the coordinates it finds into its own preallocated buffers. Islands are only created
+ * once all candidates are known, ordered by elevation and then by position so that ids do not depend on how
+ * the work was scheduled.
+ *
+ * @param grid The raster loaded by loadRaster.
+ * @return Table of the identified islands from the highest to the lowest peak, the island with id i is at index i - 1.
+ */
+vector<Island> findPeakIslands(const ElevationGrid &grid)
+{
+  int height = grid.height;
+  constexpr int isolationPixelRadius = 1;
+  static const auto findRowMaxima = selectRowMaximaKernel();
+
+  TaskPool &pool = TaskPool::shared();
+  vector<PeakCandidates> candidatesPerWorker(pool.size());
+  size_t expectedPerWorker = size_t(grid.width) * height / 64 / pool.size() + 64;
+  for (auto &candidates : candidatesPerWorker)
+  {
+    candidates.peaks.reserve(expectedPerWorker);
+    candidates.plateauSeeds.reserve(expectedPerWorker / 4);
+  }
+
+  // Bands of roughly 16k points, small enough for stealing to even out "No Data" heavy regions
+  size_t rowsPerTask = max<size_t>(1, 16384 / max(grid.width, 1));
+  pool.parallelFor(height, rowsPerTask, [&](size_t startRow, size_t endRow, unsigned worker)
+                   {
+                     auto &candidates = candidatesPerWorker[worker];
+                     if (isolationPixelRadius != 1)
+                     {
+                       processRange(grid, candidates.peaks, int(startRow), int(endRow), isolationPixelRadius);
+                       return;
+                     }
+                     for (size_t y = startRow; y < endRow; ++y)
+                     {
+                       findRowMaxima(grid, int(y), candidates);
+                     }
+                   });
+
+  auto rowMajor = [](const Coords &a, const Coords &b)
+  {
+    return a.y < b.y || (a.y == b.y && a.x < b.x);
+  };
+  vector<Coords> combinedCandidates;
+  vector<Coords> plateauSeeds;
+  for (auto &candidates : candidatesPerWorker)
+  {
+    combinedCandidates.insert(combinedCandidates.end(), candidates.peaks.begin(), candidates.peaks.end());
+    plateauSeeds.insert(plateauSeeds.end(), candidates.plateauSeeds.begin(), candidates.plateauSeeds.end());
+    candidates = PeakCandidates();
+  }
+  sort(plateauSeeds.begin(), plateauSeeds.end(), rowMajor);
+  resolvePlateaus(grid, plateauSeeds, combinedCandidates);
+  sort(combinedCandidates.begin(), combinedCandidates.end(), rowMajor);
+
+  // Highest peaks first, so that ids follow the order in which the water uncovers the peaks
+  stable_sort(combinedCandidates.begin(), combinedCandidates.end(), [&grid](const Coords &a, const Coords &b)
+              { return grid.row(a.y)[a.x] > grid.row(b.y)[b.x]; });
+
+  vector<Island> combinedIslands;
+  combinedIslands.reserve(combinedCandidates.size());
+  for (const Coords &coords : combinedCandidates)
+  {
+    combinedIslands.emplace_back(unsigned(combinedIslands.size() + 1), coords, grid.row(coords.y)[coords.x]);
+  }
+  return combinedIslands;
+}
@@ -0,0 +1,45 @@
+#include "prominence.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * @brief Copies the raster of a view into an ElevationGrid.
+ *
+ * Rows are copied one at a time, so any stride works, and go through maskNoData like the rows loadRaster
+ * reads from a file. The result is exactly what loadRaster gives for the same raster.
+ *
+ * @param view The raster.
+ * @return Pair containing metadata of the raster and the grid.
+ * @throws std::invalid_argument if the view has no pixels or its stride is shorter than a row.
+ */
+pair<datasetMetadata, ElevationGrid> gridFromView(const RasterView &view)
+{
+  size_t stride = view.stride ? view.stride : size_t(view.width);
+  if (!view.elevations || view.width <= 0 || view.height <= 0)
+  {
+    throw invalid_argument("The raster view is empty.");
+  }
+  if (stride < size_t(view.width))
+  {
+    throw invalid_argument("The stride of the raster view is shorter than its rows.");
+  }
+
+  ElevationGrid grid(view.width, view.height);
+  double maxElevation = -INFINITY;
+  double minElevation = INFINITY;
+  for (int y = 0; y < view.height; ++y)
+  {
+    const float *source = view.elevations + size_t(y) * stride;
+    copy(source, source + view.width, grid.row(y));
+  }
+  maskNoData(grid, 0, view.height, view.hasNoData, view.noDataValue, minElevation, maxElevation);
+  // A raster with nothing but "No Data" has no elevation range
+  if (maxElevation < minElevation)
+  {
+    maxElevation = minElevation = 0;
+  }
+  return make_pair(datasetMetadata(maxElevation, minElevation, view.height, view.width, view.hasNoData, view.noDataValue), std::move(grid));
+}
@@ -0,0 +1,39 @@
+#include "prominenceCore.hpp"
+#include <cmath>
+
+using namespace std;
+
+/**
+ * @brief Replaces "No Data" values in freshly loaded rows with -infinity and widens the elevation range.
+ *
+ * Run on every chunk of rows right after it is copied into the grid, while it is still in cache, so every
+ * later stage sees "No Data" points as permanently below the water level.
+ *
+ * @param grid The grid the rows were copied into.
+ * @param startRow First row of the chunk.
+ * @param rowCount Number of rows in the chunk.
+ * @param hasNoData True if the raster has a "No Data" value.
+ * @param noDataValue The "No Data" value, ignored unless hasNoData is set.
+ * @param minElevation Lowered to the lowest elevation in the chunk.
+ * @param maxElevation Raised to the highest elevation in the chunk.
+ */
+void maskNoData(ElevationGrid &grid, int startRow, int rowCount, bool hasNoData, float noDataValue, double &minElevation, double &maxElevation)
+{
+  for (int y = startRow; y < startRow + rowCount; ++y)
+  {
+    float *row = grid.row(y);
+    for (int x = 0; x < grid.width; ++x)
+    {
+      float elevation = row[x];
+      if (hasNoData && elevation == noDataValue)
+      {
+        row[x] = -INFINITY;
+        continue;
+      }
+      if (elevation > maxElevation)
+        maxElevation = elevation;
+      if (elevation < minElevation)
+        minElevation = elevation;
+    }
+  }
+}
@@ -1,6 +1,5 @@
 #include <vector>
-#include "gdal_priv.h"
-#include "gdal_computation.hpp"
+#include "prominenceCore.hpp"
 
 using namespace std;
 /**
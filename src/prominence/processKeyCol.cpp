@@ -0,0 +1,47 @@
+#include "prominenceCore.hpp"
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Processes the key col between two islands.
+ *
+ * Handles the interaction and prominence calculation between two islands at a key col.
+ *
+ * @param island1 Reference to the first Island object.
+ * @param island2 Reference to the second Island object.
+ * @param colIndex Grid index of the key col.
+ * @param grid Reference to the ElevationGrid holding the island id of every point.
+ * @param frontierPool The pool both frontiers are stored in.
+ * @param owners Records that the lower island, and everything it owned, now belongs to the higher one.
+ */
+void processKeyCol(Island &island1, Island &island2, size_t colIndex, ElevationGrid &grid, FrontierPool &frontierPool, IslandOwners &owners)
+{
+  Island *lowerIsland, *higherIsland;
+
+  // Determine which island is higher, the peak that comes first in row-major order wins between equal peaks.
+  // That is the id order as long as islands keep the peak they were found with, see waterLevelSweep
+  const Coords &peak1 = island1.peakCoords;
+  const Coords &peak2 = island2.peakCoords;
+  if (island1.elevation < island2.elevation ||
+      (island1.elevation == island2.elevation && (peak1.y > peak2.y || (peak1.y == peak2.y && peak1.x > peak2.x))))
+  {
+    lowerIsland = &island1;
+    higherIsland = &island2;
+  }
+  else
+  {
+    lowerIsland = &island2;
+    higherIsland = &island1;
+  }
+
+  // Transfer ownership of the lower island's points to the higher island, they keep their ids
+  higherIsland->frontier.splice(frontierPool, lowerIsland->frontier);
+  owners.absorb(higherIsland->id, lowerIsland->id);
+
+  // Set the prominence and flag for deletion
+  lowerIsland->flaggedForDeletion = true;
+  lowerIsland->colCoords = grid.coords(colIndex);
+  lowerIsland->colElevation = grid.elevations()[colIndex];
+  lowerIsland->prominence = lowerIsland->elevation - lowerIsland->colElevation;
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "prominenceCore.hpp"
+
+#ifndef PROMINENCE_H
+#define PROMINENCE_H
+
+/**
+ * @brief Read only view of a single band float raster held in memory by the caller.
+ *
+ * Row y starts at elevations + y * stride. The engines copy the raster into their own grid before they
+ * start, so the memory only has to stay valid for the duration of the call.
+ */
+struct RasterView
+{
+  const float *elevations = nullptr;
+  int width = 0;
+  int height = 0;
+  size_t stride = 0; // Values from the start of one row to the start of the next, 0 for tightly packed rows
+  bool hasNoData = false;
+  float noDataValue = 0;
+  std::array<double, 6> geoTransform = {0, 1, 0, 0, 0, 1}; // GDAL order: origin x, x per column, x per row, origin y, y per column, y per row
+};
+
+/**
+ * @brief The in-memory engines, both give the same peaks.
+ */
+enum class ProminenceEngine
+{
+  WaterLevel, // See waterLevelSweep
+  UnionFind   // See unionFindSweep
+};
+
+/**
+ * @brief Settings of a computeProminence call.
+ */
+struct ProminenceOptions
+{
+  ProminenceEngine engine = ProminenceEngine::WaterLevel;
+  double prominenceThreshold = 0; // Only peaks with a higher prominence are reported
+  double waterLevelStep = 1;      // Water level engine only, 0 stops at every distinct elevation
+  bool parallelExpansion = true;  // Water level engine only, false grows every island on the calling thread
+  bool pyramidPrePass = false;    // Water level engine with a step of 0 only, skips peaks that can not exceed the threshold
+};
+
+/**
+ * @brief Computes the prominence of every peak in an in-memory raster.
+ *
+ * Does no file or GDAL I/O, so it can be embedded in services that already hold their rasters. Peak and
+ * col coordinates are pixel coordinates of the view, see pixelToGeo. Calls from several threads at once
+ * are safe; each works on its own copy of the raster and they share the worker threads.
+ *
+ * @param view The raster.
+ * @param options Engine and threshold.
+ * @param emit Called on the calling thread for every peak above the threshold.
+ * @param stats Receives the phase timings and counters of the run, may be null.
+ * @throws std::invalid_argument if the view does not describe a raster.
+ */
+void computeProminence(const RasterView &view, const ProminenceOptions &options, const PeakCallback &emit, RunStats *stats = nullptr);
+
+/**
+ * @brief Same as above, but appends the peaks to peaks.
+ */
+void computeProminence(const RasterView &view, const ProminenceOptions &options, std::vector<PeakResult> &peaks, RunStats *stats = nullptr);
+
+/**
+ * @brief The prominence tree of a raster in array form: every peak above the threshold and the one it joins.
+ *
+ * parents[i] is the index in peaks of the peak peaks[i] joins at its key col, the highest peak of the island
+ * on the other side once the water is down to the col. The highest peak of a landmass has NO_PARENT. A parent
+ * is always higher and has at least the prominence of its children, so the tree of any threshold is complete.
+ */
+struct PeakTree
+{
+  static constexpr uint32_t NO_PARENT = UINT32_MAX;
+  std::vector<PeakResult> peaks;
+  std::vector<uint32_t> parents;
+};
+
+/**
+ * @brief Same as computeProminence, but links the peaks into their prominence tree.
+ */
+PeakTree computePeakTree(const RasterView &view, const ProminenceOptions &options, RunStats *stats = nullptr);
+
+/**
+ * @brief Copies a view into an ElevationGrid, the in-memory counterpart of loadRaster.
+ */
+std::pair<datasetMetadata, ElevationGrid> gridFromView(const RasterView &view);
+
+/**
+ * @brief Applies the geotransform of the view to a pixel, gives the x and y of its corner in the raster's reference system.
+ */
+inline std::pair<double, double> pixelToGeo(const RasterView &view, const Coords &pixel)
+{
+  const std::array<double, 6> &t = view.geoTransform;
+  return {t[0] + pixel.x * t[1] + pixel.y * t[2], t[3] + pixel.x * t[4] + pixel.y * t[5]};
+}
+
+#endif // PROMINENCE_H
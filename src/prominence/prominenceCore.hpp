@@ -0,0 +1,721 @@
+#include <vector>
+#include <queue>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <map>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <array>
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+#ifndef PROMINENCE_CORE_H
+#define PROMINENCE_CORE_H
+
+/**
+ * @brief Represents simple x, y coordinates.
+ *
+ * Defines a 2D point with x and y integer coordinates. Includes
+ * basic operations like equality and comparison for use in sets and maps.
+ */
+struct Coords
+{
+  int x;
+  int y;
+  Coords(int x, int y) : x(x), y(y) {}
+  Coords() {}
+  bool operator==(const Coords &other) const
+  {
+    return x == other.x && y == other.y;
+  }
+  bool operator<(const Coords &other) const
+  {
+    if (x == other.x)
+      return y < other.y;
+    return x < other.x;
+  }
+};
+/**
+ * @brief Fixed size block of point indices handed out by FrontierPool.
+ *
+ * Holds the points [begin, end) of cells and links to the next chunk of the same bucket, 128 bytes in total.
+ */
+struct FrontierChunk
+{
+  static constexpr uint32_t CAPACITY = 30;
+  uint32_t next;
+  uint16_t begin;
+  uint16_t end;
+  uint32_t cells[CAPACITY];
+};
+/**
+ * @brief Shared storage for the chunks of every island frontier.
+ *
+ * Released chunks go on a free list and are reused, so frontiers that grow and shrink as the water drains
+ * stop allocating once the pool has reached its working size.
+ */
+class FrontierPool
+{
+public:
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  uint32_t allocate()
+  {
+    uint32_t chunk = freeList;
+    if (chunk == NONE)
+    {
+      chunk = uint32_t(chunks.size());
+      chunks.emplace_back();
+    }
+    else
+    {
+      freeList = chunks[chunk].next;
+    }
+    chunks[chunk].next = NONE;
+    chunks[chunk].begin = 0;
+    chunks[chunk].end = 0;
+    return chunk;
+  }
+  void release(uint32_t chunk)
+  {
+    chunks[chunk].next = freeList;
+    freeList = chunk;
+  }
+  FrontierChunk &operator[](uint32_t chunk)
+  {
+    return chunks[chunk];
+  }
+  const FrontierChunk &operator[](uint32_t chunk) const
+  {
+    return chunks[chunk];
+  }
+  /**
+   * @brief Number of chunks ever allocated, which is the most that have been in use at once.
+   */
+  size_t chunkCount() const
+  {
+    return chunks.size();
+  }
+
+private:
+  std::vector<FrontierChunk> chunks;
+  uint32_t freeList = NONE;
+};
+/**
+ * @brief Frontier points that need to be looked at again once the water has drained down to a given level.
+ */
+struct FrontierBucket
+{
+  uint32_t levelIndex; // Position of that level in the descending list of water levels
+  uint32_t head; // Chunks are taken from the head and filled at the tail
+  uint32_t tail;
+};
+/**
+ * @brief Points on the edge of an island, bucketed by the water level at which they can grow again.
+ *
+ * The buckets are kept sorted by descending level index, so the ones that are due are always at the back. Each
+ * bucket is a queue of FrontierPool chunks; merging two frontiers links the chunk lists of buckets with
+ * the same level in constant time instead of copying points.
+ */
+struct Frontier
+{
+  std::vector<FrontierBucket> buckets;
+
+  bool empty() const
+  {
+    return buckets.empty();
+  }
+  /**
+   * @brief Level index of the earliest bucket, the frontier must not be empty.
+   */
+  uint32_t nextLevel() const
+  {
+    return buckets.back().levelIndex;
+  }
+  /**
+   * @brief Adds a point to the bucket of the given level.
+   */
+  void push(FrontierPool &pool, uint32_t levelIndex, uint32_t cell)
+  {
+    auto bucket = std::lower_bound(buckets.begin(), buckets.end(), levelIndex, [](const FrontierBucket &b, uint32_t levelIndex)
+                                   { return b.levelIndex > levelIndex; });
+    if (bucket == buckets.end() || bucket->levelIndex != levelIndex)
+    {
+      uint32_t chunk = pool.allocate();
+      bucket = buckets.insert(bucket, FrontierBucket{levelIndex, chunk, chunk});
+    }
+    if (pool[bucket->tail].end == FrontierChunk::CAPACITY)
+    {
+      uint32_t chunk = pool.allocate();
+      pool[bucket->tail].next = chunk;
+      bucket->tail = chunk;
+    }
+    FrontierChunk &tail = pool[bucket->tail];
+    tail.cells[tail.end++] = cell;
+  }
+  /**
+   * @brief Takes the next point out of the earliest bucket, if that bucket is due at the given level.
+   *
+   * @return False once no bucket at or above the level is left.
+   */
+  bool pop(FrontierPool &pool, uint32_t levelIndex, uint32_t &cell)
+  {
+    if (buckets.empty() || buckets.back().levelIndex > levelIndex)
+      return false;
+    FrontierBucket &bucket = buckets.back();
+    FrontierChunk &head = pool[bucket.head];
+    cell = head.cells[head.begin++];
+    if (head.begin == head.end)
+    {
+      uint32_t emptied = bucket.head;
+      if (emptied == bucket.tail)
+        buckets.pop_back();
+      else
+        bucket.head = head.next;
+      pool.release(emptied);
+    }
+    return true;
+  }
+  /**
+   * @brief Moves all points of other into this frontier, leaving other empty.
+   */
+  void splice(FrontierPool &pool, Frontier &other)
+  {
+    if (buckets.empty())
+    {
+      std::swap(buckets, other.buckets);
+      return;
+    }
+    for (const FrontierBucket &otherBucket : other.buckets)
+    {
+      auto bucket = std::lower_bound(buckets.begin(), buckets.end(), otherBucket.levelIndex, [](const FrontierBucket &b, uint32_t levelIndex)
+                                     { return b.levelIndex > levelIndex; });
+      if (bucket == buckets.end() || bucket->levelIndex != otherBucket.levelIndex)
+      {
+        buckets.insert(bucket, otherBucket);
+      }
+      else
+      {
+        pool[bucket->tail].next = otherBucket.head;
+        bucket->tail = otherBucket.tail;
+      }
+    }
+    other.buckets.clear();
+  }
+  /**
+   * @brief Calls visit with every point that is due at the given level, in the order pop would return them.
+   */
+  template <typename Visitor>
+  void forEachDue(const FrontierPool &pool, uint32_t levelIndex, Visitor visit) const
+  {
+    for (auto bucket = buckets.rbegin(); bucket != buckets.rend() && bucket->levelIndex <= levelIndex; ++bucket)
+    {
+      for (uint32_t chunk = bucket->head; chunk != FrontierPool::NONE; chunk = pool[chunk].next)
+      {
+        const FrontierChunk &points = pool[chunk];
+        for (uint16_t i = points.begin; i < points.end; ++i)
+          visit(points.cells[i]);
+      }
+    }
+  }
+  /**
+   * @brief Drops every point that is due at the given level.
+   */
+  void dropDue(FrontierPool &pool, uint32_t levelIndex)
+  {
+    while (!buckets.empty() && buckets.back().levelIndex <= levelIndex)
+    {
+      for (uint32_t chunk = buckets.back().head; chunk != FrontierPool::NONE;)
+      {
+        uint32_t next = pool[chunk].next;
+        pool.release(chunk);
+        chunk = next;
+      }
+      buckets.pop_back();
+    }
+  }
+  /**
+   * @brief Calls visit with every point in the frontier.
+   */
+  template <typename Visitor>
+  void forEach(const FrontierPool &pool, Visitor visit) const
+  {
+    for (const FrontierBucket &bucket : buckets)
+    {
+      for (uint32_t chunk = bucket.head; chunk != FrontierPool::NONE; chunk = pool[chunk].next)
+      {
+        const FrontierChunk &points = pool[chunk];
+        for (uint16_t i = points.begin; i < points.end; ++i)
+          visit(points.cells[i]);
+      }
+    }
+  }
+};
+/**
+ * @brief Manages island characteristics for peak prominence calculations.
+ *
+ * Handles the properties and interactions of an island, including its peak, edges,
+ * and elevation, crucial for determining its prominence in relation to other islands.
+ * Islands live by value in one table indexed by their id, see findPeakIslands.
+ */
+class Island
+{
+public:
+  unsigned int id;
+  bool flaggedForDeletion;                 // Set to true once the island has been absorbed by a higher one
+  Coords peakCoords;                       // Highest point on the island
+  Coords colCoords;                        // Key col, set once the island is absorbed by a higher one
+  double elevation;
+  double prominence;                       // The full elevation until the island is absorbed by a higher one
+  double colElevation;
+  Frontier frontier;                       // Points on the edge of the island, stored in a shared FrontierPool
+  uint32_t contactLevel;                   // Level index + 1 at which expandIslandsInParallel last saw the island touch another
+
+  Island(unsigned int id, const Coords &peakCoords, double elevation)
+      : id(id), flaggedForDeletion(false), peakCoords(peakCoords), colCoords(-1, -1), elevation(elevation), prominence(elevation), colElevation(NAN), contactLevel(0) {}
+};
+/**
+ * @brief Tracks which island every island id has been absorbed into.
+ *
+ * A disjoint set over island ids, linked by rank with path halving. Each set remembers the id of the
+ * island that still stands for it, so points keep the id of the island that claimed them and ownerOf tells
+ * which island they belong to now. Ids start at 1, as 0 marks unclaimed points.
+ */
+class IslandOwners
+{
+public:
+  explicit IslandOwners(size_t islandCount) : parent(islandCount + 1), rank(islandCount + 1, 0), owner(islandCount + 1)
+  {
+    for (unsigned int id = 0; id <= islandCount; ++id)
+    {
+      parent[id] = id;
+      owner[id] = id;
+    }
+  }
+  unsigned int ownerOf(unsigned int id)
+  {
+    return owner[root(id)];
+  }
+  /**
+   * @brief ownerOf without shortening paths, safe to call from several threads while nothing is absorbed.
+   */
+  unsigned int peekOwner(unsigned int id) const
+  {
+    while (parent[id] != id)
+      id = parent[id];
+    return owner[id];
+  }
+  /**
+   * @brief Hands everything the lower island owns to the higher one. Both have to be owners of their sets.
+   */
+  void absorb(unsigned int higherId, unsigned int lowerId)
+  {
+    unsigned int higherRoot = root(higherId);
+    unsigned int lowerRoot = root(lowerId);
+    if (rank[higherRoot] < rank[lowerRoot])
+      std::swap(higherRoot, lowerRoot);
+    parent[lowerRoot] = higherRoot;
+    if (rank[higherRoot] == rank[lowerRoot])
+      ++rank[higherRoot];
+    owner[higherRoot] = higherId;
+  }
+
+private:
+  std::vector<unsigned int> parent;
+  std::vector<uint8_t> rank;
+  std::vector<unsigned int> owner; // Island standing for the set, only meaningful at the root
+  unsigned int root(unsigned int id)
+  {
+    while (parent[id] != id)
+    {
+      parent[id] = parent[parent[id]];
+      id = parent[id];
+    }
+    return id;
+  }
+};
+/**
+ * @brief Lists the islands whose frontier is due at each water level.
+ *
+ * Every island is linked into the list of the one level at which its frontier can grow next, so a water level
+ * only visits the islands that have work to do at that level. The links are stored by island id, which
+ * makes moving an island to another level or dropping it once it has been absorbed constant time.
+ */
+class IslandSchedule
+{
+public:
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  IslandSchedule(size_t islandCount, size_t levelCount)
+      : dueLevel(islandCount + 1, NONE), previous(islandCount + 1, 0), next(islandCount + 1, 0), heads(levelCount, 0) {}
+
+  /**
+   * @brief Moves the island to the list of the given level.
+   */
+  void schedule(unsigned int id, uint32_t levelIndex)
+  {
+    if (dueLevel[id] == levelIndex)
+      return;
+    unschedule(id);
+    dueLevel[id] = levelIndex;
+    next[id] = heads[levelIndex];
+    if (next[id] != 0)
+      previous[next[id]] = id;
+    heads[levelIndex] = id;
+  }
+  void unschedule(unsigned int id)
+  {
+    if (dueLevel[id] == NONE)
+      return;
+    if (previous[id] != 0)
+      next[previous[id]] = next[id];
+    else
+      heads[dueLevel[id]] = next[id];
+    if (next[id] != 0)
+      previous[next[id]] = previous[id];
+    dueLevel[id] = NONE;
+    previous[id] = 0;
+    next[id] = 0;
+  }
+  /**
+   * @brief Takes an island out of the list of the given level.
+   *
+   * @return False once no island is due at the level.
+   */
+  bool pop(uint32_t levelIndex, unsigned int &id)
+  {
+    id = heads[levelIndex];
+    if (id == 0)
+      return false;
+    unschedule(id);
+    return true;
+  }
+
+private:
+  std::vector<uint32_t> dueLevel;     // Level the island is listed at, NONE if it is not listed
+  std::vector<unsigned int> previous; // Neighbours in the list, 0 at either end as no island has id 0
+  std::vector<unsigned int> next;
+  std::vector<unsigned int> heads;    // First island of every level
+};
+/**
+ * @brief Scratch buffers of expandIslandsInParallel, kept for a whole sweep.
+ *
+ * Every worker of the TaskPool fills its own buffers, and each level clears and refills the ones of the level
+ * before. Once they have grown to the size of the busiest level the parallel growth stops allocating, so the
+ * workers never meet on the heap. Everything is released together when the sweep ends.
+ */
+struct ParallelGrowthBuffers
+{
+  // Where the results of growing one island ended up in the buffers of the worker that grew it
+  struct Growth
+  {
+    unsigned worker;
+    size_t claimedBegin, claimedEnd;
+    size_t deferredBegin, deferredEnd;
+    uint32_t highestClaimed; // Highest point claimed, or UINT32_MAX if none was above the peak
+  };
+  struct Worker
+  {
+    std::vector<uint32_t> queue;
+    std::vector<uint32_t> claimed;                       // Points claimed by the islands this worker grew
+    std::vector<std::pair<uint32_t, uint32_t>> deferred; // Level index and point of every frontier point pushed past the level
+  };
+
+  std::vector<Worker> workers;
+  std::vector<Growth> growth; // One per due island
+
+  explicit ParallelGrowthBuffers(unsigned workerCount) : workers(workerCount) {}
+};
+/**
+ * @brief Frees buffers obtained from std::aligned_alloc.
+ */
+struct AlignedFree
+{
+  void operator()(void *ptr) const
+  {
+    std::free(ptr);
+  }
+};
+/**
+ * @brief Contiguous raster of elevations and island ids used by the prominence engines.
+ *
+ * Stored as a structure of arrays: float elevations and 32-bit island ids live in two separate
+ * 64 byte aligned buffers, 8 bytes per cell in total. The raster is surrounded by a one cell
+ * border with an elevation of -infinity that belongs to no island, so the eight neighbours of any
+ * raster cell can be read without bounds checks. Rows are padded to a whole number of cache lines,
+ * which makes every row start aligned for SIMD loads.
+ *
+ * Cells are addressed by their padded index, see index() and coords().
+ */
+class ElevationGrid
+{
+public:
+  static constexpr size_t ALIGNMENT = 64;
+  static constexpr size_t CELLS_PER_LINE = ALIGNMENT / sizeof(float);
+
+  int width;
+  int height;
+  size_t stride; // Number of cells in a padded row
+
+  ElevationGrid(int width, int height)
+      : width(width), height(height),
+        stride(paddedStride(width)),
+        elevationData(allocate<float>(stride * (size_t(height) + 2))),
+        islandIdData(allocate<uint32_t>(stride * (size_t(height) + 2)))
+  {
+    std::fill(elevationData.get(), elevationData.get() + size(), -INFINITY);
+    std::fill(islandIdData.get(), islandIdData.get() + size(), 0u);
+  }
+
+  /**
+   * @brief Number of cells in a padded row of a grid of the given width.
+   */
+  static size_t paddedStride(int width)
+  {
+    return (size_t(width) + 2 + CELLS_PER_LINE - 1) / CELLS_PER_LINE * CELLS_PER_LINE;
+  }
+  /**
+   * @brief Bytes the buffers of a grid of the given size take up.
+   */
+  static size_t bytesFor(int width, int height)
+  {
+    return paddedStride(width) * (size_t(height) + 2) * (sizeof(float) + sizeof(uint32_t));
+  }
+  /**
+   * @brief Total number of cells including the border and row padding.
+   */
+  size_t size() const
+  {
+    return stride * (size_t(height) + 2);
+  }
+  size_t index(int x, int y) const
+  {
+    return (size_t(y) + 1) * stride + size_t(x) + 1;
+  }
+  Coords coords(size_t index) const
+  {
+    return Coords(int(index % stride) - 1, int(index / stride) - 1);
+  }
+  /**
+   * @brief Index offsets of the eight neighbours (N, NE, E, SE, S, SW, W, NW) of a cell.
+   */
+  std::array<ptrdiff_t, 8> neighborOffsets() const
+  {
+    ptrdiff_t s = ptrdiff_t(stride);
+    return {-s, -s + 1, 1, s + 1, s, s - 1, -1, -s - 1};
+  }
+
+  float *elevations() { return elevationData.get(); }
+  const float *elevations() const { return elevationData.get(); }
+  uint32_t *islandIds() { return islandIdData.get(); }
+  const uint32_t *islandIds() const { return islandIdData.get(); }
+  /**
+   * @brief Pointer to the first raster cell of row y, the padded border cell is at [-1].
+   */
+  float *row(int y) { return elevationData.get() + index(0, y); }
+  const float *row(int y) const { return elevationData.get() + index(0, y); }
+
+private:
+  std::unique_ptr<float, AlignedFree> elevationData;
+  std::unique_ptr<uint32_t, AlignedFree> islandIdData;
+
+  template <typename T>
+  static T *allocate(size_t count)
+  {
+    size_t bytes = (count * sizeof(T) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    T *ptr = static_cast<T *>(std::aligned_alloc(ALIGNMENT, bytes));
+    if (!ptr)
+    {
+      throw std::bad_alloc();
+    }
+    return ptr;
+  }
+};
+/**
+ * @brief Comparator for island elevation.
+ *
+ * Defines a comparison rule for islands based on their elevation, used in findPeakIslands to sort the vector based on height
+ *
+ */
+struct CompareIsland
+{
+  bool operator()(const std::unique_ptr<Island> &a, const std::unique_ptr<Island> &b) const
+  {
+    return a->elevation < b->elevation;
+  }
+};
+/**
+ * @brief A peak together with its computed prominence.
+ *
+ * Engine independent record of a single output row, written to the CSV by a ResultSink.
+ */
+struct PeakResult
+{
+  Coords peakCoords;
+  double elevation;
+  double prominence;
+  Coords colCoords;    // Key col, (-1, -1) for the highest peak of a landmass
+  double colElevation; // NaN for the highest peak of a landmass
+  Coords parentCoords; // Highest peak of the island this one joins at its key col, once the water is down to the col. (-1, -1) for the highest peak of a landmass
+  PeakResult(const Coords &peakCoords, double elevation, double prominence, const Coords &colCoords = Coords(-1, -1), double colElevation = NAN,
+             const Coords &parentCoords = Coords(-1, -1))
+      : peakCoords(peakCoords), elevation(elevation), prominence(prominence), colCoords(colCoords), colElevation(colElevation), parentCoords(parentCoords) {}
+};
+/**
+ * @brief Disjoint-set forest over raster cells used by the union-find prominence engine.
+ *
+ * Cells are identified by indices below the size the forest was created with, in whatever index space the
+ * caller uses: the engines pass padded ElevationGrid indices of the grid or tile they sweep (see
+ * ElevationGrid::index), and stitchTiles the ids of boundary nodes. Every component remembers the index of its
+ * highest peak, so when two components meet at a col the peak that loses the merge can be read off in constant
+ * time. Uses path halving and union by size.
+ */
+class PeakForest
+{
+public:
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  PeakForest() = default;
+  explicit PeakForest(size_t cellCount)
+  {
+    reset(cellCount);
+  }
+
+  /**
+   * @brief Empties the forest for cellCount cells, reusing the memory it already holds.
+   */
+  void reset(size_t cellCount)
+  {
+    parent.assign(cellCount, NONE);
+    // Only parent tells which cells are in, makeSet sets the rest
+    peak.resize(cellCount);
+    size.resize(cellCount);
+  }
+
+  bool contains(uint32_t cell) const
+  {
+    return parent[cell] != NONE;
+  }
+  void makeSet(uint32_t cell)
+  {
+    parent[cell] = cell;
+    peak[cell] = cell;
+    size[cell] = 1;
+  }
+  uint32_t find(uint32_t cell)
+  {
+    while (parent[cell] != cell)
+    {
+      parent[cell] = parent[parent[cell]];
+      cell = parent[cell];
+    }
+    return cell;
+  }
+  uint32_t peakOf(uint32_t root) const
+  {
+    return peak[root];
+  }
+  /**
+   * @brief Returns the root, out of rootCount roots, whose component has the highest peak.
+   */
+  template <typename IsHigher>
+  uint32_t highestRoot(const uint32_t *roots, int rootCount, IsHigher isHigher) const
+  {
+    uint32_t winner = roots[0];
+    for (int i = 1; i < rootCount; ++i)
+    {
+      if (isHigher(peak[roots[i]], peak[winner]))
+        winner = roots[i];
+    }
+    return winner;
+  }
+  /**
+   * @brief Merges the components meeting at the col cell.
+   *
+   * The component with the highest peak survives. onAbsorbed(root, winnerRoot) is called for every other
+   * component before it is linked, which is the moment its peak reaches its key col. The col itself must already
+   * be a set of its own and is added to the merged component.
+   *
+   * @return The root of the merged component.
+   */
+  template <typename IsHigher, typename OnAbsorbed>
+  uint32_t mergeAtCol(uint32_t col, const uint32_t *roots, int rootCount, IsHigher isHigher, OnAbsorbed onAbsorbed)
+  {
+    uint32_t winner = highestRoot(roots, rootCount, isHigher);
+    uint32_t mergedRoot = winner;
+    for (int i = 0; i < rootCount; ++i)
+    {
+      if (roots[i] == winner)
+        continue;
+      onAbsorbed(roots[i], winner);
+      mergedRoot = link(mergedRoot, roots[i]);
+    }
+    return link(mergedRoot, col);
+  }
+  /**
+   * @brief Joins the component of loserRoot into the component of winnerRoot.
+   *
+   * The merged component keeps the peak of winnerRoot regardless of which root ends up on top.
+   *
+   * @return The root of the merged component.
+   */
+  uint32_t link(uint32_t winnerRoot, uint32_t loserRoot)
+  {
+    uint32_t winnerPeak = peak[winnerRoot];
+    if (size[winnerRoot] < size[loserRoot])
+      std::swap(winnerRoot, loserRoot);
+    parent[loserRoot] = winnerRoot;
+    size[winnerRoot] += size[loserRoot];
+    peak[winnerRoot] = winnerPeak;
+    return winnerRoot;
+  }
+
+private:
+  std::vector<uint32_t> parent;
+  std::vector<uint32_t> peak;
+  std::vector<uint32_t> size;
+};
+/**
+ * @brief Holds metadata for the dataset.
+ *
+ * Encapsulates important information about the dataset, such as
+ * maximum and minimum elevations (ignoring "No Data" points), the "No Data"
+ * value and the dataset's dimensions.
+ */
+struct datasetMetadata
+{
+  double maxElevation;
+  double minElevation;
+  int height;
+  int width;
+  bool hasNoData;
+  double noDataValue;
+  datasetMetadata(double maxElevation, double minElevation, int height, int width, bool hasNoData = false, double noDataValue = 0)
+      : maxElevation(maxElevation), minElevation(minElevation), height(height), width(width), hasNoData(hasNoData), noDataValue(noDataValue) {}
+};
+
+// Functions defined in their own files
+
+class RunStats;
+
+/**
+ * @brief Receives the peaks an engine finds, one call per peak above the prominence threshold.
+ */
+using PeakCallback = std::function<void(const PeakResult &)>;
+
+void waterLevelSweep(ElevationGrid &grid, const datasetMetadata &metaData, double prominenceThreshold, double waterLevelStep, bool parallelExpansion, bool pyramidPrePass, const PeakCallback &emit, RunStats &stats);
+void unionFindSweep(const ElevationGrid &grid, double prominenceThreshold, const PeakCallback &emit, RunStats &stats);
+void maskNoData(ElevationGrid &grid, int startRow, int rowCount, bool hasNoData, float noDataValue, double &minElevation, double &maxElevation);
+std::vector<Coords> neighbors(Coords coords, int datasetHeight, int datasetWidth);
+std::vector<float> waterLevels(const ElevationGrid &grid, const datasetMetadata &metaData, double step);
+std::vector<Island> findPeakIslands(const ElevationGrid &grid);
+size_t prunePeakIslands(const ElevationGrid &grid, std::vector<Island> &islands, double prominenceThreshold);
+void processRange(const ElevationGrid &grid, std::vector<Coords> &candidates, int startRow, int endRow, int isolationRadius);
+void processKeyCol(Island &island1, Island &island2, size_t colIndex, ElevationGrid &grid, FrontierPool &frontierPool, IslandOwners &owners);
+void expandIslandsInParallel(std::vector<unsigned int> &dueIslands, uint32_t levelIndex, const std::vector<float> &levels, std::vector<Island> &islands, ElevationGrid &grid, const IslandOwners &owners, FrontierPool &frontierPool, IslandSchedule &schedule, ParallelGrowthBuffers &buffers, bool raisePeaks);
+
+#endif // PROMINENCE_CORE_H
@@ -0,0 +1,114 @@
+#include "prominenceCore.hpp"
+#include "taskPool.hpp"
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+  // Lowest and highest elevation within a block of a pyramid level
+  struct BlockRange
+  {
+    float low;
+    float high;
+  };
+
+  struct PyramidLevel
+  {
+    int width;
+    int height;
+    vector<BlockRange> blocks;
+  };
+
+  /**
+   * Pools 2 by 2 blocks of the level below, or of the grid itself for the first level.
+   */
+  PyramidLevel poolLevel(int width, int height, const function<BlockRange(int, int)> &rangeAt)
+  {
+    PyramidLevel level{(width + 1) / 2, (height + 1) / 2, {}};
+    level.blocks.resize(size_t(level.width) * level.height);
+    TaskPool::shared().parallelFor(size_t(level.height), 64, [&](size_t startRow, size_t endRow, unsigned)
+                                   {
+                                     for (size_t by = startRow; by < endRow; ++by)
+                                     {
+                                       for (int bx = 0; bx < level.width; ++bx)
+                                       {
+                                         BlockRange range = rangeAt(2 * bx, int(2 * by));
+                                         for (auto [dx, dy] : {pair(1, 0), pair(0, 1), pair(1, 1)})
+                                         {
+                                           if (2 * bx + dx >= width || int(2 * by) + dy >= height)
+                                             continue;
+                                           BlockRange other = rangeAt(2 * bx + dx, int(2 * by) + dy);
+                                           range.low = min(range.low, other.low);
+                                           range.high = max(range.high, other.high);
+                                         }
+                                         level.blocks[by * level.width + bx] = range;
+                                       }
+                                     } });
+    return level;
+  }
+}
+
+/**
+ * @brief Drops the peaks that a min/max pyramid of the grid proves can not have a prominence above the threshold.
+ *
+ * Level k of the pyramid holds the lowest and the highest point of every aligned block of 2^k by 2^k points.
+ * All points of a block are land once the water is down to the block's lowest point, and a block is
+ * connected, so a peak that is not the highest point of some block is joined to higher ground by then: its
+ * key col is at least the block's lowest point. If its elevation is no more than the threshold above that
+ * point, its prominence can not exceed the threshold. Blocks with "No Data" points have -infinity as their
+ * lowest point and never prove anything.
+ *
+ * The pyramid is built from the loaded grid instead of GDAL overviews, which are resampled and bound nothing.
+ *
+ * @param grid The raster, as loaded by loadRaster or gridFromView.
+ * @param islands The islands of findPeakIslands, the survivors keep their order and get new consecutive ids.
+ * @param prominenceThreshold Only peaks that may have a higher prominence are kept.
+ * @return Number of islands dropped.
+ */
+size_t prunePeakIslands(const ElevationGrid &grid, vector<Island> &islands, double prominenceThreshold)
+{
+  vector<PyramidLevel> pyramid;
+  pyramid.push_back(poolLevel(grid.width, grid.height, [&grid](int x, int y)
+                              {
+                                float elevation = grid.row(y)[x];
+                                return BlockRange{elevation, elevation}; }));
+  while (pyramid.back().width > 1 || pyramid.back().height > 1)
+  {
+    const PyramidLevel &below = pyramid.back();
+    pyramid.push_back(poolLevel(below.width, below.height, [&below](int x, int y)
+                                { return below.blocks[size_t(y) * below.width + x]; }));
+  }
+
+  auto mayExceedThreshold = [&](const Island &island)
+  {
+    for (size_t k = 0; k < pyramid.size(); ++k)
+    {
+      const PyramidLevel &level = pyramid[k];
+      const BlockRange &block = level.blocks[size_t(island.peakCoords.y >> (k + 1)) * level.width + size_t(island.peakCoords.x >> (k + 1))];
+      // Larger blocks only reach lower
+      if (island.elevation - double(block.low) > prominenceThreshold)
+        return true;
+      if (block.high > island.elevation)
+        return false;
+    }
+    return true;
+  };
+
+  size_t kept = 0;
+  for (Island &island : islands)
+  {
+    if (!mayExceedThreshold(island))
+      continue;
+    Island &survivor = islands[kept++];
+    if (&survivor != &island)
+      survivor = std::move(island);
+    survivor.id = unsigned(kept);
+  }
+  size_t dropped = islands.size() - kept;
+  islands.erase(islands.begin() + ptrdiff_t(kept), islands.end());
+  return dropped;
+}
@@ -0,0 +1,133 @@
+#include "runStats.hpp"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <sys/resource.h>
+
+using namespace std;
+
+namespace
+{
+  // Peak resident set size of the process, in bytes
+  uint64_t peakResidentBytes()
+  {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+      return 0;
+#ifdef __APPLE__
+    return uint64_t(usage.ru_maxrss);
+#else
+    return uint64_t(usage.ru_maxrss) * 1024;
+#endif
+  }
+
+  // Names are chosen by the engines, but escape them anyway so the summary is always valid JSON
+  string jsonString(const string &value)
+  {
+    string quoted = "\"";
+    for (char c : value)
+    {
+      if (c == '"' || c == '\\')
+        quoted += '\\';
+      if (static_cast<unsigned char>(c) >= 0x20)
+        quoted += c;
+    }
+    return quoted + '"';
+  }
+}
+
+RunStats::RunStats(string engine, bool progress) : engine(std::move(engine)), printProgress(progress), start(Clock::now()), nextProgress(start + PROGRESS_INTERVAL) {}
+
+double RunStats::secondsSince(Clock::time_point from, Clock::time_point to)
+{
+  return chrono::duration<double>(to - from).count();
+}
+
+void RunStats::beginPhase(const string &name)
+{
+  endPhase();
+  currentPhase = name;
+  phaseStart = Clock::now();
+}
+
+void RunStats::endPhase()
+{
+  if (currentPhase.empty())
+    return;
+  double seconds = secondsSince(phaseStart, Clock::now());
+  if (printProgress)
+    cout << currentPhase << " took " << seconds << " s" << endl;
+  addPhase(currentPhase, seconds);
+  currentPhase.clear();
+}
+
+void RunStats::addPhase(const string &name, double seconds)
+{
+  // A phase that runs more than once, like the output of several batches, adds up
+  for (auto &phase : phases)
+  {
+    if (phase.first == name)
+    {
+      phase.second += seconds;
+      return;
+    }
+  }
+  phases.emplace_back(name, seconds);
+}
+
+void RunStats::count(const string &name, uint64_t value)
+{
+  for (auto &counter : counters)
+  {
+    if (counter.first == name)
+    {
+      counter.second = value;
+      return;
+    }
+  }
+  counters.emplace_back(name, value);
+}
+
+void RunStats::add(const RunStats &run)
+{
+  for (const auto &phase : run.phases)
+    addPhase(phase.first, phase.second);
+  for (const auto &counter : run.counters)
+  {
+    bool highWater = counter.first.ends_with("_high_water");
+    bool found = false;
+    for (auto &existing : counters)
+    {
+      if (existing.first == counter.first)
+      {
+        existing.second = highWater ? max(existing.second, counter.second) : existing.second + counter.second;
+        found = true;
+      }
+    }
+    if (!found)
+      counters.push_back(counter);
+  }
+}
+
+void RunStats::writeJson(const string &path)
+{
+  endPhase();
+  double totalSeconds = secondsSince(start, Clock::now());
+  ofstream file(path);
+  if (!file.is_open())
+    throw runtime_error("Unable to open statistics file: " + path);
+
+  file << "{\n  \"engine\": " << jsonString(engine) << ",\n  \"total_seconds\": " << totalSeconds << ",\n  \"phases\": {";
+  for (size_t i = 0; i < phases.size(); ++i)
+    file << (i ? ", " : "") << jsonString(phases[i].first) << ": " << phases[i].second;
+  file << "},\n  \"counters\": {";
+  for (size_t i = 0; i < counters.size(); ++i)
+    file << (i ? ", " : "") << jsonString(counters[i].first) << ": " << counters[i].second;
+  file << "},\n  \"peak_rss_bytes\": " << peakResidentBytes();
+  for (const auto &counter : counters)
+  {
+    if (counter.first == "cells" && totalSeconds > 0)
+      file << ",\n  \"cells_per_second\": " << uint64_t(counter.second / totalSeconds);
+  }
+  file << "\n}\n";
+}
@@ -0,0 +1,86 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef RUN_STATS_H
+#define RUN_STATS_H
+
+/**
+ * @brief Phase timers, counters and progress reporting for one prominence run.
+ *
+ * The engines split their work into named phases and record counters as they go. If progress is enabled,
+ * progress() prints at most one line per PROGRESS_INTERVAL, so it can be called from hot loops. At the end
+ * writeJson() stores everything, together with the peak memory use of the process, as a JSON summary.
+ * Not thread safe, callers reporting from several threads have to serialize their calls.
+ */
+class RunStats
+{
+public:
+  using Clock = std::chrono::steady_clock;
+  static constexpr std::chrono::seconds PROGRESS_INTERVAL{1};
+
+  /**
+   * @param engine Name of the engine, stored in the summary.
+   * @param progress If true, progress lines and phase timings are printed to stdout.
+   */
+  explicit RunStats(std::string engine = "", bool progress = false);
+
+  /**
+   * @brief Ends the running phase, if any, and starts timing the named one.
+   */
+  void beginPhase(const std::string &name);
+  /**
+   * @brief Ends the running phase.
+   */
+  void endPhase();
+
+  /**
+   * @brief Sets a counter, adding it if it does not exist yet.
+   */
+  void count(const std::string &name, uint64_t value);
+
+  /**
+   * @brief Adds the phase times and counters of a finished run to this one, for runs over several datasets.
+   *
+   * Counters are added up, except high water marks (names ending in "_high_water"), which keep the larger value.
+   */
+  void add(const RunStats &run);
+
+  /**
+   * @brief Prints the line describe() returns, unless a line has been printed within the last PROGRESS_INTERVAL.
+   */
+  template <typename Describe>
+  void progress(Describe describe)
+  {
+    if (!printProgress)
+      return;
+    Clock::time_point now = Clock::now();
+    if (now < nextProgress)
+      return;
+    nextProgress = now + PROGRESS_INTERVAL;
+    std::cout << '[' << secondsSince(start, now) << " s] " << currentPhase << ": " << describe() << std::endl;
+  }
+
+  /**
+   * @brief Writes the summary to path as a JSON object. Ends the running phase.
+   */
+  void writeJson(const std::string &path);
+
+private:
+  std::string engine;
+  bool printProgress;
+  Clock::time_point start;
+  Clock::time_point phaseStart;
+  Clock::time_point nextProgress;
+  std::string currentPhase;
+  std::vector<std::pair<std::string, double>> phases; // Seconds spent in each phase, in the order they ran
+  std::vector<std::pair<std::string, uint64_t>> counters;
+
+  static double secondsSince(Clock::time_point from, Clock::time_point to);
+  void addPhase(const std::string &name, double seconds);
+};
+
+#endif // RUN_STATS_H
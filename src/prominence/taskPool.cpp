@@ -0,0 +1,199 @@
+#include "taskPool.hpp"
+#include <algorithm>
+
+using namespace std;
+
+namespace
+{
+  uint64_t packRange(uint32_t begin, uint32_t end)
+  {
+    return (uint64_t(end) << 32) | begin;
+  }
+  uint32_t rangeBegin(uint64_t range)
+  {
+    return uint32_t(range);
+  }
+  uint32_t rangeEnd(uint64_t range)
+  {
+    return uint32_t(range >> 32);
+  }
+  // Set while the current thread runs a task, nested loops then run inline instead of deadlocking
+  thread_local bool insideTask = false;
+  thread_local unsigned currentWorker = 0;
+}
+
+TaskPool::TaskPool(unsigned workerCount) : workerCount(max(workerCount, 1u)), ranges(new WorkRange[max(workerCount, 1u)])
+{
+  for (unsigned worker = 1; worker < this->workerCount; ++worker)
+  {
+    threads.emplace_back(&TaskPool::workerLoop, this, worker);
+  }
+}
+
+TaskPool::~TaskPool()
+{
+  {
+    lock_guard<mutex> lock(poolMutex);
+    stopping = true;
+  }
+  wakeWorkers.notify_all();
+  for (auto &t : threads)
+  {
+    t.join();
+  }
+}
+
+TaskPool &TaskPool::shared()
+{
+  static TaskPool pool;
+  return pool;
+}
+
+void TaskPool::parallelFor(size_t count, size_t grain, const RangeTask &task)
+{
+  if (count == 0)
+    return;
+  grain = max<size_t>(grain, 1);
+  size_t chunkCount = (count + grain - 1) / grain;
+  if (chunkCount > UINT32_MAX)
+  {
+    grain = (count + UINT32_MAX - 1) / UINT32_MAX;
+    chunkCount = (count + grain - 1) / grain;
+  }
+  // Not worth waking anyone up for
+  if (workerCount == 1 || chunkCount == 1 || insideTask)
+  {
+    bool wasInsideTask = insideTask;
+    unsigned worker = wasInsideTask ? currentWorker : 0;
+    insideTask = true;
+    currentWorker = worker;
+    task(0, count, worker);
+    insideTask = wasInsideTask;
+    return;
+  }
+
+  lock_guard<mutex> jobLock(jobMutex);
+
+  // Deal out equal contiguous chunk ranges, the thieves even out the rest
+  for (unsigned worker = 0; worker < workerCount; ++worker)
+  {
+    uint32_t begin = uint32_t(chunkCount * worker / workerCount);
+    uint32_t end = uint32_t(chunkCount * (worker + 1) / workerCount);
+    ranges[worker].range.store(packRange(begin, end), memory_order_relaxed);
+  }
+  {
+    lock_guard<mutex> lock(poolMutex);
+    currentTask = &task;
+    currentCount = count;
+    currentGrain = grain;
+    busyWorkers = workerCount - 1;
+    ++generation;
+  }
+  wakeWorkers.notify_all();
+
+  runChunks(0);
+
+  unique_lock<mutex> lock(poolMutex);
+  jobDone.wait(lock, [this]
+               { return busyWorkers == 0; });
+  currentTask = nullptr;
+}
+
+void TaskPool::workerLoop(unsigned worker)
+{
+  uint64_t seenGeneration = 0;
+  while (true)
+  {
+    {
+      unique_lock<mutex> lock(poolMutex);
+      wakeWorkers.wait(lock, [&]
+                       { return stopping || generation != seenGeneration; });
+      if (stopping)
+        return;
+      seenGeneration = generation;
+    }
+
+    runChunks(worker);
+
+    {
+      lock_guard<mutex> lock(poolMutex);
+      if (--busyWorkers == 0)
+        jobDone.notify_one();
+    }
+  }
+}
+
+void TaskPool::runChunks(unsigned worker)
+{
+  const RangeTask &task = *currentTask;
+  insideTask = true;
+  currentWorker = worker;
+  uint32_t chunk;
+  do
+  {
+    while (popChunk(worker, chunk))
+    {
+      size_t begin = size_t(chunk) * currentGrain;
+      size_t end = min(begin + currentGrain, currentCount);
+      task(begin, end, worker);
+    }
+  } while (stealChunks(worker));
+  insideTask = false;
+}
+
+/**
+ * @brief Takes the next chunk from the front of the worker's own range.
+ */
+bool TaskPool::popChunk(unsigned worker, uint32_t &chunk)
+{
+  auto &own = ranges[worker].range;
+  uint64_t range = own.load(memory_order_acquire);
+  while (rangeBegin(range) < rangeEnd(range))
+  {
+    if (own.compare_exchange_weak(range, packRange(rangeBegin(range) + 1, rangeEnd(range)), memory_order_acq_rel))
+    {
+      chunk = rangeBegin(range);
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Moves the back half of the largest range of another worker into the worker's own, now empty, range.
+ *
+ * @return False once there is nothing left to steal.
+ */
+bool TaskPool::stealChunks(unsigned worker)
+{
+  while (true)
+  {
+    unsigned victim = worker;
+    uint32_t largest = 0;
+    for (unsigned other = 0; other < workerCount; ++other)
+    {
+      uint64_t range = ranges[other].range.load(memory_order_acquire);
+      uint32_t remaining = rangeEnd(range) > rangeBegin(range) ? rangeEnd(range) - rangeBegin(range) : 0;
+      if (other != worker && remaining > largest)
+      {
+        largest = remaining;
+        victim = other;
+      }
+    }
+    if (victim == worker)
+      return false;
+
+    auto &victimRange = ranges[victim].range;
+    uint64_t range = victimRange.load(memory_order_acquire);
+    uint32_t begin = rangeBegin(range);
+    uint32_t end = rangeEnd(range);
+    if (begin >= end)
+      continue;
+    uint32_t stolen = (end - begin + 1) / 2;
+    if (victimRange.compare_exchange_strong(range, packRange(begin, end - stolen), memory_order_acq_rel))
+    {
+      ranges[worker].range.store(packRange(end - stolen, end), memory_order_release);
+      return true;
+    }
+  }
+}
@@ -0,0 +1,87 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+/**
+ * @brief Small fixed-size thread pool that runs parallel loops with work stealing.
+ *
+ * A loop is split into chunks and every worker starts out with an equal, contiguous range of them.
+ * Workers take chunks from the front of their own range; a worker whose range runs dry steals the back
+ * half of the largest remaining range of another worker. Uneven chunks, like row bands that are mostly
+ * "No Data" ocean, therefore do not leave cores idle. The calling thread takes part as worker 0.
+ *
+ * Loops started from several threads at once are run one after another, and a loop started from inside
+ * a task runs inline on the calling worker.
+ */
+class TaskPool
+{
+public:
+  /**
+   * @brief Signature of a loop body: the half open item range [begin, end) and the index of the worker running it.
+   */
+  using RangeTask = std::function<void(size_t begin, size_t end, unsigned worker)>;
+
+  explicit TaskPool(unsigned workerCount = std::thread::hardware_concurrency());
+  ~TaskPool();
+  TaskPool(const TaskPool &) = delete;
+  TaskPool &operator=(const TaskPool &) = delete;
+
+  /**
+   * @brief Number of workers, including the calling thread. Worker indexes passed to tasks are below this.
+   */
+  unsigned size() const
+  {
+    return workerCount;
+  }
+
+  /**
+   * @brief Runs task over the items [0, count) in chunks of at most grain items and waits for all of them.
+   *
+   * @param count Number of items.
+   * @param grain Maximum number of items handed to a single task call.
+   * @param task The loop body.
+   */
+  void parallelFor(size_t count, size_t grain, const RangeTask &task);
+
+  /**
+   * @brief The process wide pool, sized to the hardware concurrency.
+   */
+  static TaskPool &shared();
+
+private:
+  // Chunk range [begin, end) of one worker, packed into one word so owner and thieves can race on it with CAS
+  struct alignas(64) WorkRange
+  {
+    std::atomic<uint64_t> range{0};
+  };
+
+  unsigned workerCount;
+  std::vector<std::thread> threads;
+  std::unique_ptr<WorkRange[]> ranges;
+
+  std::mutex jobMutex; // Held for the duration of a parallelFor
+  std::mutex poolMutex;
+  std::condition_variable wakeWorkers;
+  std::condition_variable jobDone;
+  uint64_t generation = 0;
+  unsigned busyWorkers = 0;
+  bool stopping = false;
+  const RangeTask *currentTask = nullptr;
+  size_t currentCount = 0;
+  size_t currentGrain = 1;
+
+  void workerLoop(unsigned worker);
+  void runChunks(unsigned worker);
+  bool popChunk(unsigned worker, uint32_t &chunk);
+  bool stealChunks(unsigned worker);
+};
+
+#endif // TASK_POOL_H
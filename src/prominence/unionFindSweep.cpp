@@ -0,0 +1,148 @@
+#include "prominenceCore.hpp"
+#include "runStats.hpp"
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * @brief Calculates peak prominences on a loaded grid with a single union-find sweep.
+ *
+ * Alternative to the water level engine in waterLevelSweep. Every cell is sorted once by
+ * elevation and the cells are then added from the highest to the lowest. A cell with no already
+ * added neighbour starts a new component (a peak). A cell that touches several components is a
+ * col: all components except the one with the highest peak are merged into it, and the peaks of
+ * the absorbed components get their prominence from the elevation of that col. Components that are
+ * never absorbed (the highest peak, or islands separated by "No Data" cells) get their elevation
+ * as prominence, matching the water level engine.
+ *
+ * The cost is O(N log N) for the sort plus a near linear sweep, independent of the vertical relief.
+ *
+ * @param grid The raster, as loaded by loadRaster or gridFromView.
+ * @param prominenceThreshold Minimum prominence value for peaks to be reported.
+ * @param emit Receives the peaks once the sweep is done, always on the calling thread.
+ * @param stats Receives the phase timings and counters of the run. The "output" phase is left running, so
+ * the caller can count the time to finish writing the peaks.
+ */
+void unionFindSweep(const ElevationGrid &grid, double prominenceThreshold, const PeakCallback &emit, RunStats &stats)
+{
+  const float *elevations = grid.elevations();
+  const auto neighborOffsets = grid.neighborOffsets();
+  size_t cellCount = grid.size();
+  if (cellCount >= PeakForest::NONE)
+  {
+    throw runtime_error("Dataset is too large for the union-find engine.");
+  }
+
+  stats.beginPhase("init");
+  // Sort the cells from highest to lowest, ties broken by index so that runs are deterministic
+  vector<uint32_t> order;
+  order.reserve(size_t(grid.width) * grid.height);
+  for (int y = 0; y < grid.height; ++y)
+  {
+    for (int x = 0; x < grid.width; ++x)
+    {
+      uint32_t cell = grid.index(x, y);
+      // "No Data" points are loaded as -infinity and never join a component
+      if (elevations[cell] == -INFINITY)
+        continue;
+      order.push_back(cell);
+    }
+  }
+  auto isHigher = [&elevations](uint32_t a, uint32_t b)
+  {
+    return elevations[a] > elevations[b] || (elevations[a] == elevations[b] && a < b);
+  };
+  sort(order.begin(), order.end(), isHigher);
+
+  stats.beginPhase("sweep");
+  PeakForest forest(cellCount);
+  vector<PeakResult> results;
+  uint64_t peakCount = 0;
+  uint64_t mergeCount = 0;
+  auto recordPeak = [&](uint32_t peakCell, uint32_t colCell)
+  {
+    double colElevation = colCell == PeakForest::NONE ? NAN : elevations[colCell];
+    double prominence = colCell == PeakForest::NONE ? elevations[peakCell] : double(elevations[peakCell]) - colElevation;
+    if (prominence <= prominenceThreshold)
+      return false;
+    results.emplace_back(grid.coords(peakCell), elevations[peakCell], prominence,
+                         colCell == PeakForest::NONE ? Coords(-1, -1) : grid.coords(colCell), colElevation);
+    return true;
+  };
+  // Peaks that reached their key col at the elevation being swept, with the root they merged into. Their parent
+  // is the highest peak of that component once every cell of this elevation is in
+  vector<pair<size_t, uint32_t>> levelPeaks;
+  float levelElevation = INFINITY;
+  auto finishLevel = [&]()
+  {
+    for (const auto &[resultIndex, root] : levelPeaks)
+      results[resultIndex].parentCoords = grid.coords(forest.peakOf(forest.find(root)));
+    levelPeaks.clear();
+  };
+
+  for (size_t done = 0; done < order.size(); ++done)
+  {
+    uint32_t cell = order[done];
+    if (elevations[cell] != levelElevation)
+    {
+      finishLevel();
+      levelElevation = elevations[cell];
+    }
+    if ((done & 0xFFFF) == 0)
+      stats.progress([&]
+                     { return to_string(done * 100 / order.size()) + "% of the cells, " + to_string(peakCount) + " peaks, " + to_string(mergeCount) + " merges"; });
+    // Collect the distinct components among the neighbours that are already above the sweep.
+    // The grid border is never part of a component, so no bounds checks are needed
+    uint32_t roots[8];
+    int rootCount = 0;
+    for (ptrdiff_t offset : neighborOffsets)
+    {
+      uint32_t neighbor = uint32_t(cell + offset);
+      if (!forest.contains(neighbor))
+        continue;
+      uint32_t root = forest.find(neighbor);
+      if (find(roots, roots + rootCount, root) == roots + rootCount)
+        roots[rootCount++] = root;
+    }
+
+    forest.makeSet(cell);
+    if (rootCount == 0)
+    {
+      ++peakCount;
+      continue; // A new peak
+    }
+
+    // The component with the highest peak survives, every other one has reached its key col
+    forest.mergeAtCol(cell, roots, rootCount, isHigher, [&](uint32_t lowerRoot, uint32_t winnerRoot)
+                      {
+                        uint32_t lowerPeak = forest.peakOf(lowerRoot);
+                        if (recordPeak(lowerPeak, cell))
+                          levelPeaks.emplace_back(results.size() - 1, winnerRoot);
+                        ++mergeCount;
+                      });
+  }
+  finishLevel();
+
+  // Components that never merged into a higher one keep their full elevation as prominence
+  for (uint32_t cell : order)
+  {
+    if (forest.find(cell) == cell)
+    {
+      uint32_t peakCell = forest.peakOf(cell);
+      recordPeak(peakCell, PeakForest::NONE);
+    }
+  }
+
+  stats.beginPhase("output");
+  for (const auto &peak : results)
+  {
+    emit(peak);
+  }
+
+  stats.count("cells", uint64_t(grid.width) * grid.height);
+  stats.count("peaks", peakCount);
+  stats.count("merges", mergeCount);
+}
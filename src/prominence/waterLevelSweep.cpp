@@ -0,0 +1,254 @@
+#include "prominenceCore.hpp"
+#include "taskPool.hpp"
+#include "runStats.hpp"
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+/**
+ * @brief Calculates peak prominences on a loaded grid using the water level method.
+ *
+ * Simulates lowering water levels to identify and analyze individual islands (peaks). Whenever two islands
+ * meet at a key col the lower one has its prominence, and the islands that are never absorbed keep their
+ * elevation as prominence. Peaks with a prominence above the threshold are passed to emit, in the order the
+ * water reaches their key col followed by the remaining islands from the highest to the lowest.
+ * The water only stops at levels where there is land (see waterLevels), so the runtime follows the
+ * number of occupied elevation bands rather than the vertical relief.
+ * Levels with many islands due are first grown in parallel, see expandIslandsInParallel, which gives the
+ * same result as growing them one after another.
+ *
+ * With the pyramid pre-pass, prunePeakIslands first drops the peaks that provably can not exceed the threshold,
+ * which on noisy terrain is most of them, so they never get an island or a frontier. Their land is claimed by
+ * whichever island reaches it first, and an island that claims a point higher than its peak takes that point
+ * as its peak, just as if the island had been absorbed by the dropped peak's island. The dropped peak is
+ * higher than the island, so that island's prominence was at most the threshold as well. Every peak above the
+ * threshold therefore gets the same prominence, key col elevation and parent as without the pre-pass. Where
+ * several points at the col's elevation join the same two islands, the islands may meet at a different one
+ * of them. This relies on the water stopping at every distinct elevation, so the pre-pass needs a water level
+ * step of 0.
+ *
+ * @param grid The raster, as loaded by loadRaster or gridFromView. Its island ids are overwritten.
+ * @param metaData Elevation range of the raster.
+ * @param prominenceThreshold Minimum prominence value for peaks to be reported.
+ * @param waterLevelStep How far the water drains per step, or 0 to stop at every distinct elevation.
+ * @param parallelExpansion If false, every island is grown on the calling thread.
+ * @param pyramidPrePass If true, peaks that can not exceed the threshold are dropped before the sweep.
+ * @param emit Receives the peaks, always on the calling thread.
+ * @param stats Receives the phase timings and counters of the run. The "output" phase is left running, so
+ * the caller can count the time to finish writing the peaks.
+ */
+void waterLevelSweep(ElevationGrid &grid, const datasetMetadata &metaData, double prominenceThreshold, double waterLevelStep, bool parallelExpansion, bool pyramidPrePass, const PeakCallback &emit, RunStats &stats)
+{
+  // Frontiers store points as 32-bit indices into the padded grid
+  if (grid.size() >= UINT32_MAX)
+  {
+    throw runtime_error("Dataset is too large for the water level engine.");
+  }
+  if (pyramidPrePass && waterLevelStep != 0)
+  {
+    throw invalid_argument("The pyramid pre-pass needs a water level step of 0.");
+  }
+  stats.beginPhase("peaks");
+  vector<Island> islands = findPeakIslands(grid);
+  size_t peakCount = islands.size();
+  if (pyramidPrePass)
+  {
+    stats.beginPhase("pyramid");
+    stats.count("peaks_pruned", prunePeakIslands(grid, islands, prominenceThreshold));
+  }
+  stats.beginPhase("init");
+
+  float *elevations = grid.elevations();
+  uint32_t *islandIds = grid.islandIds();
+  const auto neighborOffsets = grid.neighborOffsets();
+  // The water starts at the highest point and drains down through the levels that contain land
+  vector<float> levels = waterLevels(grid, metaData, waterLevelStep);
+  if (levels.size() >= UINT32_MAX)
+  {
+    throw runtime_error("Too many water levels, use a larger water level step.");
+  }
+  // Index of the first level at which the water has drained below the given elevation
+  auto levelIndexBelow = [&levels](float elevation)
+  {
+    return uint32_t(lower_bound(levels.begin(), levels.end(), elevation, greater<float>()) - levels.begin());
+  };
+  // The islands due at each level, and the next island the water will uncover
+  IslandSchedule schedule(islands.size(), levels.size());
+  // The islands due at the current level, visited in id order, and the level each one was last queued at
+  priority_queue<unsigned int, vector<unsigned int>, greater<unsigned int>> dueIslands;
+  vector<uint32_t> queuedAt(islands.size() + 1, IslandSchedule::NONE);
+  size_t nextIsland = 0;
+  size_t activeIslandCount = 0;
+  auto islandById = [&islands](unsigned int id) -> Island &
+  {
+    return islands[id - 1];
+  };
+  IslandOwners owners(islands.size());
+  // Row-major order of the points breaks ties, like it does between the peaks in processKeyCol
+  auto isAbovePeak = [&grid, elevations](size_t index, const Island &island)
+  {
+    return elevations[index] > island.elevation ||
+           (elevations[index] == island.elevation && index < grid.index(island.peakCoords.x, island.peakCoords.y));
+  };
+  FrontierPool frontierPool;
+  // Below this many due islands a level is not worth waking the workers for
+  constexpr size_t minParallelIslands = 64;
+  parallelExpansion = parallelExpansion && TaskPool::shared().size() > 1;
+  ParallelGrowthBuffers growthBuffers(parallelExpansion ? TaskPool::shared().size() : 0);
+  vector<unsigned int> levelIslands;
+  vector<pair<PeakResult, unsigned int>> levelPeaks; // Peaks that reached their key col at this level, and the island they joined
+  uint64_t mergeCount = 0;
+  uint64_t committedInParallel = 0;
+
+  stats.beginPhase("sweep");
+  for (uint32_t levelIndex = 0; levelIndex < levels.size(); ++levelIndex)
+  {
+    float waterLevel = levels[levelIndex];
+    stats.progress([&]
+                   {
+                     ostringstream line;
+                     line << "level " << levelIndex + 1 << "/" << levels.size() << ", water at " << waterLevel << ", "
+                          << activeIslandCount << " active islands, " << mergeCount << " merges";
+                     return line.str(); });
+
+    while (nextIsland < islands.size() && islands[nextIsland].elevation >= waterLevel)
+    {
+      Island &islandPeak = islands[nextIsland++];
+      size_t peakIndex = grid.index(islandPeak.peakCoords.x, islandPeak.peakCoords.y);
+      islandIds[peakIndex] = islandPeak.id;
+      islandPeak.frontier.push(frontierPool, levelIndex, uint32_t(peakIndex));
+      schedule.schedule(islandPeak.id, levelIndex);
+      ++activeIslandCount;
+    }
+
+    levelIslands.clear();
+    unsigned int islandId;
+    while (schedule.pop(levelIndex, islandId))
+    {
+      levelIslands.push_back(islandId);
+      queuedAt[islandId] = levelIndex;
+    }
+    // Islands that do not touch any other island at this level are done after this, the rest is grown below
+    if (parallelExpansion && levelIslands.size() >= minParallelIslands)
+    {
+      sort(levelIslands.begin(), levelIslands.end());
+      size_t dueCount = levelIslands.size();
+      expandIslandsInParallel(levelIslands, levelIndex, levels, islands, grid, owners, frontierPool, schedule, growthBuffers, pyramidPrePass);
+      committedInParallel += dueCount - levelIslands.size();
+    }
+    for (unsigned int id : levelIslands)
+      dueIslands.push(id);
+    while (!dueIslands.empty())
+    {
+      Island &island = islandById(dueIslands.top());
+      dueIslands.pop();
+      uint32_t frontierIndex;
+
+      // Grow the island point by point until no frontier point is due at this water level
+      while (!island.flaggedForDeletion && island.frontier.pop(frontierPool, levelIndex, frontierIndex))
+      {
+        float frontierElevation = elevations[frontierIndex];
+        float highestUnderwater = -INFINITY;
+
+        // Check the neighboring points, the grid border is never above water so no bounds checks are needed
+        for (ptrdiff_t offset : neighborOffsets)
+        {
+          size_t neighborIndex = frontierIndex + offset;
+          float neighborElevation = elevations[neighborIndex];
+          uint32_t neighborIslandId = islandIds[neighborIndex];
+          // Points under water decide when this frontier point has to be looked at again
+          if (neighborElevation < waterLevel)
+          {
+            highestUnderwater = max(highestUnderwater, neighborElevation);
+            continue;
+          }
+          if (neighborIslandId == island.id)
+            continue;
+          // If the neighboring point is not claimed by any island and is above the water line we will add it to the frontier
+          if (neighborIslandId == 0)
+          {
+            // Land above the peak can only belong to a pruned peak
+            if (pyramidPrePass && isAbovePeak(neighborIndex, island))
+            {
+              island.elevation = neighborElevation;
+              island.peakCoords = grid.coords(neighborIndex);
+            }
+            islandIds[neighborIndex] = island.id;
+            island.frontier.push(frontierPool, levelIndex, uint32_t(neighborIndex));
+          }
+          else if (unsigned int ownerId = owners.ownerOf(neighborIslandId); ownerId != island.id) // If it is a part of another island, we have reached a key col and we can calculate prominence
+          {
+            // Points of absorbed islands keep their id, the owner is the island that absorbed them
+            Island &otherIsland = islandById(ownerId);
+            // Whichever island survives the col looks at this point again
+            island.frontier.push(frontierPool, levelIndex, frontierIndex);
+            highestUnderwater = -INFINITY;
+            processKeyCol(island, otherIsland, neighborElevation < frontierElevation ? neighborIndex : frontierIndex, grid, frontierPool, owners);
+            Island &lowerIsland = island.flaggedForDeletion ? island : otherIsland;
+            Island &higherIsland = island.flaggedForDeletion ? otherIsland : island;
+            if (lowerIsland.prominence > prominenceThreshold)
+              levelPeaks.emplace_back(PeakResult(lowerIsland.peakCoords, lowerIsland.elevation, lowerIsland.prominence, lowerIsland.colCoords, lowerIsland.colElevation), higherIsland.id);
+            schedule.unschedule(lowerIsland.id);
+            --activeIslandCount;
+            ++mergeCount;
+            // The other island may now have points due earlier, or even at this level. If it has already had its turn
+            // at this level they wait for the next one
+            if (island.flaggedForDeletion)
+            {
+              uint32_t otherLevel = otherIsland.frontier.nextLevel();
+              if (otherLevel > levelIndex)
+                schedule.schedule(otherIsland.id, otherLevel);
+              else if (otherIsland.id > island.id && queuedAt[otherIsland.id] != levelIndex)
+              {
+                schedule.unschedule(otherIsland.id);
+                dueIslands.push(otherIsland.id);
+                queuedAt[otherIsland.id] = levelIndex;
+              }
+              else if (otherIsland.id < island.id && levelIndex + 1 < levels.size())
+                schedule.schedule(otherIsland.id, levelIndex + 1);
+            }
+            break;
+          }
+        }
+
+        // Points next to water stay in the frontier until the water drains down to their lower neighbours.
+        // "No Data" points are loaded as -infinity and never drain
+        if (highestUnderwater != -INFINITY)
+        {
+          island.frontier.push(frontierPool, levelIndexBelow(highestUnderwater), frontierIndex);
+        }
+      }
+
+      if (!island.flaggedForDeletion && !island.frontier.empty())
+        schedule.schedule(island.id, island.frontier.nextLevel());
+    }
+
+    // The parent of a peak is the highest peak of the island it joined, once every island at this level has grown
+    for (auto &[peak, higherId] : levelPeaks)
+    {
+      peak.parentCoords = islandById(owners.ownerOf(higherId)).peakCoords;
+      emit(peak);
+    }
+    levelPeaks.clear();
+  }
+  // Report any remaining islands, the ones never absorbed keep their elevation as prominence
+  stats.beginPhase("output");
+  for (const Island &island : islands)
+  {
+    if (!island.flaggedForDeletion && island.prominence > prominenceThreshold)
+      emit(PeakResult(island.peakCoords, island.elevation, island.prominence, island.colCoords, island.colElevation));
+  }
+
+  stats.count("cells", uint64_t(grid.width) * grid.height);
+  stats.count("peaks", peakCount);
+  stats.count("water_levels", levels.size());
+  stats.count("merges", mergeCount);
+  stats.count("islands_grown_in_parallel", committedInParallel);
+  stats.count("frontier_capacity_high_water", uint64_t(frontierPool.chunkCount()) * FrontierChunk::CAPACITY);
+}
@@ -0,0 +1,66 @@
+#include "prominenceCore.hpp"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+using namespace std;
+
+/**
+ * @brief Lists the water levels the water level engine has to stop at, from the highest to the lowest.
+ *
+ * With a positive step the elevations are grouped into bands of that height, aligned to multiples of the
+ * step, and every band that contains at least one point gives one level: the bottom of the band. Bands
+ * without points are skipped. With a step of 0 every distinct elevation in the raster is a level of its own,
+ * which gives exact col elevations at the cost of one level per distinct value.
+ *
+ * @param grid The loaded elevation raster, "No Data" points are stored as -infinity and ignored
+ * @param metaData Minimum and maximum elevation of the raster
+ * @param step Height of a band in the units of the raster, or 0 for the distinct elevations
+ * @return The levels in descending order
+ */
+vector<float> waterLevels(const ElevationGrid &grid, const datasetMetadata &metaData, double step)
+{
+  vector<float> levels;
+  if (step > 0)
+  {
+    long long lowestBand = (long long)floor(metaData.minElevation / step);
+    long long highestBand = (long long)floor(metaData.maxElevation / step);
+    size_t bandCount = size_t(highestBand - lowestBand + 1);
+    // Marking the occupied bands is linear as long as there are not more bands than points
+    if (bandCount <= size_t(grid.width) * grid.height)
+    {
+      vector<bool> occupied(bandCount, false);
+      for (int y = 0; y < grid.height; ++y)
+      {
+        const float *row = grid.row(y);
+        for (int x = 0; x < grid.width; ++x)
+        {
+          if (row[x] != -INFINITY)
+            occupied[size_t((long long)floor(row[x] / step) - lowestBand)] = true;
+        }
+      }
+      for (size_t band = bandCount; band-- > 0;)
+      {
+        if (occupied[band])
+          levels.push_back(float((lowestBand + (long long)band) * step));
+      }
+      return levels;
+    }
+  }
+
+  levels.reserve(size_t(grid.width) * grid.height);
+  for (int y = 0; y < grid.height; ++y)
+  {
+    const float *row = grid.row(y);
+    for (int x = 0; x < grid.width; ++x)
+    {
+      if (row[x] != -INFINITY)
+        levels.push_back(step > 0 ? float(floor(row[x] / step) * step) : row[x]);
+    }
+  }
+  sort(levels.begin(), levels.end(), greater<float>());
+  levels.erase(unique(levels.begin(), levels.end()), levels.end());
+  levels.shrink_to_fit();
+  return levels;
+}
@@ -0,0 +1,46 @@
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+
+#include "computation/peakColumns.hpp"
+
+using namespace std;
+
+/**
+ * @brief Prints a .pfc peak file written by PeakFinder as CSV, with every value at full precision.
+ *
+ * Only depends on peakColumns.hpp, so it builds without GDAL and can be used to check the format.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc != 2)
+  {
+    cerr << "Usage: " << argv[0] << " <peaks.pfc>" << endl;
+    return EXIT_FAILURE;
+  }
+
+  try
+  {
+    PeakColumnsReader reader(argv[1]);
+    printf("x,y,prominence,latitude,longitude,elevation,col_x,col_y,col_elevation,parent_x,parent_y\n");
+    for (size_t group = 0; group < reader.rowGroupCount(); ++group)
+    {
+      const auto &rows = reader.rowGroup(group);
+      for (size_t i = 0; i < rows.rowCount; ++i)
+      {
+        int parentX = rows.parentX ? rows.parentX[i] : -1;
+        int parentY = rows.parentY ? rows.parentY[i] : -1;
+        printf("%d,%d,%.17g,%.17g,%.17g,%.17g,%d,%d,%.17g,%d,%d\n", rows.x[i], rows.y[i], rows.prominence[i], rows.latitude[i],
+               rows.longitude[i], rows.elevation[i], rows.colX[i], rows.colY[i], rows.colElevation[i], parentX, parentY);
+      }
+    }
+    cerr << reader.rowCount() << " peaks in " << reader.rowGroupCount() << " row groups" << endl;
+  }
+  catch (const exception &e)
+  {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}